@@ -0,0 +1,221 @@
+#include "asyncWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define PYTHIAPROJECT_HAVE_IO_URING 1
+#endif
+
+
+
+//==========================================================================
+// The ring is set up with the raw system calls, so no liburing is needed. Only this process
+// touches the submission queue, and it submits one entry per call.
+
+static const uint64_t fsyncTag = ~0ull;
+
+#ifdef PYTHIAPROJECT_HAVE_IO_URING
+
+struct AsyncWriter::Ring {
+    int fd = -1;
+    void *sqMap = MAP_FAILED, *cqMap = MAP_FAILED;
+    size_t sqLength = 0, cqLength = 0, sqesLength = 0;
+    io_uring_sqe *sqes = nullptr;
+    unsigned *sqTail, *sqMask, *sqArray, *cqHead, *cqTail, *cqMask;
+    io_uring_cqe *cqes;
+};
+
+static void closeRing(AsyncWriter::Ring *ring) {
+    if (ring->sqes) munmap(ring->sqes, ring->sqesLength);
+    if (ring->cqMap != MAP_FAILED && ring->cqMap != ring->sqMap) munmap(ring->cqMap, ring->cqLength);
+    if (ring->sqMap != MAP_FAILED) munmap(ring->sqMap, ring->sqLength);
+    if (ring->fd >= 0) close(ring->fd);
+    delete ring;
+}
+
+static AsyncWriter::Ring *openRing(unsigned entries) {
+    io_uring_params params{};
+    int fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) return nullptr; //ENOSYS, EPERM under seccomp, ...
+    auto ring = new AsyncWriter::Ring;
+    ring->fd = fd;
+    ring->sqLength = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqLength = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) ring->sqLength = ring->cqLength = std::max(ring->sqLength, ring->cqLength);
+    ring->sqMap = mmap(nullptr, ring->sqLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                       IORING_OFF_SQ_RING);
+    ring->cqMap = single ? ring->sqMap : mmap(nullptr, ring->cqLength, PROT_READ | PROT_WRITE,
+                                              MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    ring->sqesLength = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, ring->sqesLength, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                      IORING_OFF_SQES);
+    if (ring->sqMap == MAP_FAILED || ring->cqMap == MAP_FAILED || sqes == MAP_FAILED) {
+        closeRing(ring);
+        return nullptr;
+    }
+    ring->sqes = static_cast<io_uring_sqe *>(sqes);
+    auto sq = static_cast<char *>(ring->sqMap), cq = static_cast<char *>(ring->cqMap);
+    ring->sqTail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sqMask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned *) (sq + params.sq_off.array);
+    ring->cqHead = (unsigned *) (cq + params.cq_off.head);
+    ring->cqTail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cqMask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (io_uring_cqe *) (cq + params.cq_off.cqes);
+    return ring;
+}
+
+// At most maxInFlight + 1 entries are outstanding, fewer than the ring has, so there is always space.
+static void submitEntry(AsyncWriter::Ring *ring, uint8_t opcode, int fd, const void *data, size_t n,
+                        uint64_t offset, uint64_t tag) {
+    unsigned tail = *ring->sqTail, index = tail & *ring->sqMask;
+    io_uring_sqe &sqe = ring->sqes[index];
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = opcode;
+    sqe.fd = fd;
+    sqe.addr = (uint64_t) data;
+    sqe.len = n;
+    sqe.off = offset;
+    sqe.user_data = tag;
+    if (opcode == IORING_OP_FSYNC) sqe.fsync_flags = IORING_FSYNC_DATASYNC;
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    while (syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, nullptr, 0) < 0 && errno == EINTR);
+}
+
+static io_uring_cqe waitCompletion(AsyncWriter::Ring *ring) {
+    for (;;) {
+        unsigned head = *ring->cqHead;
+        if (head != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe cqe = ring->cqes[head & *ring->cqMask];
+            __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+            return cqe;
+        }
+        syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    }
+}
+
+#else
+
+struct AsyncWriter::Ring {};
+static void closeRing(AsyncWriter::Ring *ring) { delete ring; }
+static AsyncWriter::Ring *openRing(unsigned) { return nullptr; }
+
+#endif
+
+static bool writeFully(int fd, const char *data, size_t n, uint64_t offset) {
+    while (n > 0) {
+        ssize_t written = pwrite(fd, data, n, offset);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written, n -= written, offset += written;
+    }
+    return true;
+}
+
+//==========================================================================
+
+AsyncWriter::AsyncWriter(const std::string &file, const WriterOptions &options)
+        : file(file), options(options) {
+    this->options.chunkSize = std::max<size_t>(options.chunkSize, 4096);
+    this->options.maxInFlight = std::max(options.maxInFlight, 1);
+    fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        printf("Cannot open %s: %s\n", file.c_str(), strerror(errno));
+        return;
+    }
+    if (options.async) ring = openRing(this->options.maxInFlight + 2);
+    chunks.resize(ring ? this->options.maxInFlight + 1 : 1);
+    for (auto &chunk: chunks) chunk.data.resize(this->options.chunkSize);
+}
+
+void AsyncWriter::submit(Chunk &chunk) {
+    if (chunk.used == 0) return;
+    chunk.offset = appended - chunk.used; //only the current chunk is partly filled
+#ifdef PYTHIAPROJECT_HAVE_IO_URING
+    if (ring) {
+        submitEntry(ring, IORING_OP_WRITE, fd, chunk.data.data(), chunk.used, chunk.offset, &chunk - chunks.data());
+        chunk.inFlight = true;
+        ++nInFlight;
+        return;
+    }
+#endif
+    if (!writeFully(fd, chunk.data.data(), chunk.used, chunk.offset)) failed = true;
+    chunk.used = 0;
+}
+
+void AsyncWriter::waitOne() {
+#ifdef PYTHIAPROJECT_HAVE_IO_URING
+    io_uring_cqe cqe = waitCompletion(ring);
+    --nInFlight;
+    if (cqe.user_data == fsyncTag) {
+        if (cqe.res < 0) fdatasync(fd);
+        return;
+    }
+    Chunk &chunk = chunks[cqe.user_data];
+    size_t written = cqe.res < 0 ? 0 : cqe.res;
+    if (written < chunk.used && //short write or an error, e.g. IORING_OP_WRITE unknown to an old kernel
+        !writeFully(fd, chunk.data.data() + written, chunk.used - written, chunk.offset + written))
+        failed = true;
+    chunk.inFlight = false;
+    chunk.used = 0;
+#endif
+}
+
+void AsyncWriter::write(const void *data, size_t n) {
+    if (fd < 0) return;
+    auto from = static_cast<const char *>(data);
+    while (n > 0) {
+        Chunk &chunk = chunks[current];
+        size_t take = std::min(n, options.chunkSize - chunk.used);
+        memcpy(chunk.data.data() + chunk.used, from, take);
+        chunk.used += take, appended += take, from += take, n -= take;
+        if (chunk.used == options.chunkSize) {
+            submit(chunk);
+            current = (current + 1) % chunks.size();
+            while (chunks[current].inFlight) waitOne();
+        }
+    }
+}
+
+void AsyncWriter::drain() {
+    submit(chunks[current]);
+    current = (current + 1) % chunks.size();
+    while (nInFlight > 0) waitOne();
+}
+
+void AsyncWriter::writeAt(const void *data, size_t n, uint64_t offset) {
+    if (fd < 0) return;
+    drain();
+    if (!writeFully(fd, static_cast<const char *>(data), n, offset)) failed = true;
+}
+
+void AsyncWriter::close() {
+    if (fd < 0) return;
+    drain();
+    if (options.fsync) {
+#ifdef PYTHIAPROJECT_HAVE_IO_URING
+        if (ring) {
+            submitEntry(ring, IORING_OP_FSYNC, fd, nullptr, 0, 0, fsyncTag);
+            ++nInFlight;
+            waitOne();
+        } else
+#endif
+            fdatasync(fd);
+    }
+    if (failed) printf("Writing %s failed: %s\n", file.c_str(), strerror(errno));
+    if (ring) closeRing(ring);
+    ring = nullptr;
+    ::close(fd);
+    fd = -1;
+}
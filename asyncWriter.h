@@ -0,0 +1,64 @@
+//
+// Append-only file writer which hands full chunks to the kernel through io_uring and keeps filling
+// the next chunk meanwhile. Without io_uring (old kernel, seccomp, other OS) the chunks are written
+// with pwrite() by the caller, same file, same chunking.
+//
+
+#ifndef PYTHIAPROJECT_ASYNCWRITER_H
+#define PYTHIAPROJECT_ASYNCWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+
+struct WriterOptions {
+    bool async = true;       //io_uring if the kernel allows it
+    size_t chunkSize = 4 << 20;
+    int maxInFlight = 4;     //chunks written at the same time, one more is being filled
+    bool fsync = false;      //fdatasync before close, through the ring as well
+};
+
+class AsyncWriter {
+public:
+    AsyncWriter(const std::string &file, const WriterOptions &options = WriterOptions());
+    ~AsyncWriter() { close(); }
+    AsyncWriter(const AsyncWriter &) = delete;
+    AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+    bool good() const { return fd >= 0 && !failed; }
+    bool usingIoUring() const { return ring != nullptr; }
+    uint64_t size() const { return appended; } //bytes appended so far
+
+    void write(const void *data, size_t n);
+    void writeAt(const void *data, size_t n, uint64_t offset); //waits for all writes, e.g. to rewrite a header
+    void close();
+
+    struct Ring; //io_uring mappings, asyncWriter.cpp
+
+private:
+    struct Chunk {
+        std::vector<char> data;
+        size_t used = 0;
+        uint64_t offset = 0;
+        bool inFlight = false;
+    };
+
+    void submit(Chunk &chunk);
+    void waitOne();
+    void drain();
+
+    std::string file;
+    WriterOptions options;
+    int fd = -1;
+    bool failed = false;
+    Ring *ring = nullptr;
+    std::vector<Chunk> chunks;
+    size_t current = 0;
+    int nInFlight = 0;
+    uint64_t appended = 0;
+};
+
+#endif //PYTHIAPROJECT_ASYNCWRITER_H
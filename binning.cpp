@@ -0,0 +1,39 @@
+#include "binning.h"
+
+#include "TMath.h"
+
+
+
+Binning::Binning(int nX, int nY, double xMax)
+        : nX(nX), nY(nY), xMin(-xMax), xMax(xMax), yMin(-TMath::Pi()), yMax(TMath::Pi()) {
+    xCenters.resize(nX + 2);
+    xEdges.resize(nX + 2);
+    yCenters.resize(nY + 2);
+    yEdges.resize(nY + 2);
+    for (int i = 1; i <= nX + 1; ++i) {
+        xCenters[i] = center(i, nX, xMin, xMax);
+        xEdges[i] = edge(i, nX, xMin, xMax);
+    }
+    for (int i = 1; i <= nY + 1; ++i) {
+        yCenters[i] = center(i, nY, yMin, yMax);
+        yEdges[i] = edge(i, nY, yMin, yMax);
+    }
+}
+
+Binning::Binning(Pythia8::Settings &settings)
+        : Binning(settings.mode("Display:nRapidityBins"), settings.mode("Display:nPhiBins"),
+                  settings.parm("Display:rapidityMax")) {}
+
+std::vector<fastjet::PseudoJet> makeGhosts(const Binning &binning, double pTghost) {
+    std::vector<fastjet::PseudoJet> ghosts;
+    ghosts.reserve(binning.nX * binning.nY);
+    fastjet::PseudoJet ghost;
+    for (int iy = 1; iy <= binning.nX; ++iy) {
+        for (int iphi = 1; iphi <= binning.nY; ++iphi) {
+            ghost.reset_momentum_PtYPhiM(pTghost, binning.xCenters[iy], binning.yCenters[iphi], 0);
+            ghost.set_user_index(binning.bin(iy, iphi));
+            ghosts.push_back(ghost);
+        }
+    }
+    return ghosts;
+}
@@ -0,0 +1,43 @@
+//
+// Rapidity-azimuth binning of the jet images, shared by ghosts, histograms and drawing.
+//
+
+#ifndef PYTHIAPROJECT_BINNING_H
+#define PYTHIAPROJECT_BINNING_H
+
+#include <vector>
+
+#include "Pythia8/Pythia.h"
+#include "fastjet/PseudoJet.hh"
+
+
+
+class Binning {
+public:
+    //bins numbered as in ROOT: 1..n, 0 and n + 1 are under- and overflow
+    static constexpr double edge(int i, int n, double min, double max) { return min + (max - min) * (i - 1) / n; }
+    static constexpr double center(int i, int n, double min, double max) {
+        return min + (max - min) * (i - 0.5) / n;
+    }
+    static constexpr int find(double x, int n, double min, double max) {
+        return x < min ? 0 : x >= max ? n + 1 : 1 + int((x - min) * n / (max - min));
+    }
+
+    Binning(int nX, int nY, double xMax); //x - rapidity in (-xMax, xMax), y - azimuth in (-pi, pi)
+    explicit Binning(Pythia8::Settings &settings); //Display:nRapidityBins, Display:nPhiBins, Display:rapidityMax
+
+    int nX, nY;
+    double xMin, xMax, yMin, yMax;
+    std::vector<double> xCenters, yCenters, xEdges, yEdges; //indexed by bin number, edges are low edges
+
+    int findX(double y) const { return find(y, nX, xMin, xMax); }
+    int findY(double phi) const { return find(phi, nY, yMin, yMax); }
+    int bin(int ix, int iy) const { return ix + (nX + 2) * iy; } //global bin of TH2
+    int bin(double y, double phi) const { return bin(findX(y), findY(phi)); }
+    double cellArea() const { return (xMax - xMin) / nX * (yMax - yMin) / nY; } //of one bin, one ghost
+};
+
+//one ghost in the center of every bin, its user_index is the global bin
+std::vector<fastjet::PseudoJet> makeGhosts(const Binning &binning, double pTghost = 1e-100);
+
+#endif //PYTHIAPROJECT_BINNING_H
@@ -0,0 +1,99 @@
+#include "displayExport.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+
+static const char displayMagic[8] = {'P', 'P', 'J', 'D', 'I', 'S', 'P', '1'};
+
+static std::string jsonString(const std::string &s) {
+    std::string quoted = "\"";
+    for (char c: s) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        if ((unsigned char) c >= 0x20) quoted += c;
+    }
+    return quoted + "\"";
+}
+
+DisplayExporter::DisplayExporter(const std::string &file, const Binning &binning,
+                                 const std::vector<std::string> &definitions, double pTminJet,
+                                 double pTminHadron, const WriterOptions &options)
+        : out(file, options), binning(binning) {
+    if (!out.good()) {
+        printf("Cannot open display export %s\n", file.c_str());
+        return;
+    }
+    char numbers[512];
+    snprintf(numbers, sizeof(numbers),
+             "{\"version\": 1, \"rapidityBins\": %d, \"phiBins\": %d, \"rapidityMin\": %.9g, \"rapidityMax\": %.9g, "
+             "\"phiMin\": %.9g, \"phiMax\": %.9g, \"pTminJet\": %.9g, \"pTminHadron\": %.9g, \"definitions\": [",
+             binning.nX, binning.nY, binning.xMin, binning.xMax, binning.yMin, binning.yMax, pTminJet, pTminHadron);
+    std::string json = numbers;
+    for (size_t d = 0; d < definitions.size(); ++d) json += (d ? ", " : "") + jsonString(definitions[d]);
+    json += "]}";
+    json.resize((json.size() + 3) & ~size_t(3), ' ');
+    uint32_t jsonBytes = json.size();
+    out.write(displayMagic, 8);
+    out.write(&jsonBytes, 4);
+    out.write(json.data(), json.size());
+}
+
+//==========================================================================
+// One record per event. The label grid is run-length coded, jets cover connected areas, so an
+// event takes a few kB instead of a label for each of the nX * nY cells.
+
+void DisplayExporter::write(int event, double weight, const Pythia8::Particle *particles, size_t n,
+                            EventJets &jets) {
+    if (!out.good()) return;
+    y.clear(), phi.clear(), pT.clear(), charge.clear();
+    for (size_t i = 0; i < n; ++i) {
+        auto &p = particles[i];
+        if (std::abs(p.y()) >= binning.xMax) continue; //outside of the picture
+        y.push_back(p.y()), phi.push_back(p.phi()), pT.push_back(p.pT());
+        charge.push_back(p.charge() > 0 ? 1 : p.charge() < 0 ? -1 : 0);
+    }
+    uint32_t nParticles = y.size();
+
+    record.clear();
+    uint32_t head[4] = {0, uint32_t(event), nParticles, 0};
+    float weight32 = weight;
+    memcpy(&head[3], &weight32, 4);
+    append(head, 4);
+    append(y.data(), nParticles), append(phi.data(), nParticles), append(pT.data(), nParticles);
+    append(charge.data(), nParticles);
+    record.resize((record.size() + 3) & ~size_t(3), 0);
+
+    int nX = binning.nX, nY = binning.nY;
+    for (size_t d = 0; d < jets.size(); ++d) {
+        auto &list = jets.jets(d);
+        labels.assign(size_t(nX) * nY, 0);
+        jetPt.clear(), jetY.clear(), jetPhi.clear();
+        for (size_t k = 0; k < list.size(); ++k) {
+            jetPt.push_back(list[k].pt()), jetY.push_back(list[k].rap()), jetPhi.push_back(list[k].phi_std());
+            uint16_t label = std::min<size_t>(k + 1, 65535);
+            for (auto &c: list[k].constituents()) {
+                if (c.pt() > 1e-50) continue; //ghosts only, they know their bin
+                int ix = c.user_index() % (nX + 2), iy = c.user_index() / (nX + 2);
+                labels[(ix - 1) + size_t(nX) * (iy - 1)] = label;
+            }
+        }
+        runLabel.clear(), runLength.clear();
+        for (size_t cell = 0; cell < labels.size();) {
+            size_t end = cell + 1;
+            while (end < labels.size() && labels[end] == labels[cell] && end - cell < 65535) ++end;
+            runLabel.push_back(labels[cell]);
+            runLength.push_back(end - cell);
+            cell = end;
+        }
+        uint32_t counts[2] = {uint32_t(list.size()), uint32_t(runLabel.size())};
+        append(counts, 2);
+        append(jetPt.data(), jetPt.size()), append(jetY.data(), jetY.size()), append(jetPhi.data(), jetPhi.size());
+        append(runLabel.data(), runLabel.size()), append(runLength.data(), runLength.size());
+    }
+
+    uint32_t recordBytes = record.size();
+    memcpy(record.data(), &recordBytes, 4);
+    out.write(record.data(), record.size());
+    ++nEvents;
+}
@@ -0,0 +1,58 @@
+//
+// Events for the browser viewer eventDisplay.html: particles and, for every jet definition, the jets
+// and the jet label of every (y, phi) cell, as in the PDF pages. Written through AsyncWriter, so the
+// export keeps up with the generation.
+//
+
+#ifndef PYTHIAPROJECT_DISPLAYEXPORT_H
+#define PYTHIAPROJECT_DISPLAYEXPORT_H
+
+#include <string>
+#include <vector>
+
+#include "Pythia8/Pythia.h"
+
+#include "asyncWriter.h"
+#include "binning.h"
+#include "eventJets.h"
+
+
+
+// File layout, little endian, every part starts at a multiple of 4 bytes:
+//   "PPJDISP1", jsonBytes uint32, JSON header padded with spaces (binning, pT cuts, definitions)
+//   per event:  recordBytes uint32 (all of the record), event int32, nParticles uint32, weight float32
+//               y, phi, pT float32 [nParticles], charge int8 [nParticles] padded to 4
+//               per definition: nJets uint32, nRuns uint32, pT, y, phi float32 [nJets],
+//                               label uint16 [nRuns], length uint16 [nRuns]
+// The labels run over the cells ix + nRapidityBins * iy (from 0), label k + 1 is the k-th jet by pT,
+// 0 - no jet. The file is read from the start, there is no index.
+class DisplayExporter {
+public:
+    DisplayExporter(const std::string &file, const Binning &binning, const std::vector<std::string> &definitions,
+                    double pTminJet, double pTminHadron, const WriterOptions &options = WriterOptions());
+    ~DisplayExporter() { close(); }
+
+    bool good() const { return out.good(); }
+    long size() const { return nEvents; }
+    uint64_t bytes() const { return out.size(); }
+
+    //jets must have been clustered with the ghosts of the binning (makeGhosts), otherwise the cells stay empty
+    void write(int event, double weight, const Pythia8::Particle *particles, size_t n, EventJets &jets);
+    void close() { out.close(); }
+
+private:
+    template<class T>
+    void append(const T *data, size_t n) {
+        record.insert(record.end(), (const char *) data, (const char *) (data + n));
+    }
+
+    AsyncWriter out;
+    Binning binning;
+    long nEvents = 0;
+    std::vector<char> record;
+    std::vector<float> y, phi, pT, jetPt, jetY, jetPhi;
+    std::vector<int8_t> charge;
+    std::vector<uint16_t> labels, runLabel, runLength;
+};
+
+#endif //PYTHIAPROJECT_DISPLAYEXPORT_H
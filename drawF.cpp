@@ -1,10 +1,10 @@
 #include "drawF.h"
+#include "graphicsPool.h"
 
 
 
-void drawParticles_histogram(std::vector<Pythia8::Particle> & particles_histogram, double minpT){
+void drawParticles_histogram(std::vector<Pythia8::Particle> & particles_histogram, double minpT, double yMax){
     int colPos = kRed, colNeg = kBlue, colNeut = kGreen + 3;
-    double yMax = 4;
     for (auto &p: particles_histogram) {
         if (!( std::abs(p.y()) < yMax && p.pT() > minpT )) continue; //gets things only in canvas
         if (p.charge() > 0) {
@@ -18,9 +18,9 @@ void drawParticles_histogram(std::vector<Pythia8::Particle> & particles_histogra
     }
 }
 
-TH2D * createTH2D(int nXBins, int nYBins, double nXMax){ //don't forget to free the memory
+TH2D * createTH2D(const Binning &binning){ //don't forget to free the memory
     auto result = new TH2D("", ";Rapidity #it{y};Azimuth #it{#phi};Jet #it{p}_{T} [GeV]",
-                           nXBins, -nXMax, nXMax, nYBins, -TMath::Pi(), TMath::Pi());
+                           binning.nX, binning.xMin, binning.xMax, binning.nY, binning.yMin, binning.yMax);
 
     result->GetYaxis()->SetTitleOffset(0.5);//offset of y-axis label "Phi"
     result->GetZaxis()->SetTitleOffset(1.3); //offset of z-axis label "pT"
@@ -28,12 +28,48 @@ TH2D * createTH2D(int nXBins, int nYBins, double nXMax){ //don't forget to free
 
 }
 
+void legendBoxNDC(double &x1, double &y1, double &x2, double &y2) {
+    double x = 0.67, y = 0.814, dx = 0.19, dy = 0.126; //parameters for the size of the legend box
+    x1 = x, y1 = y, x2 = x + dx, y2 = y + dy;
+}
+
+//==========================================================================
+// Whole page of one jet definition: jet areas filled with the jet pT,
+// particles on top, titles and legend.
+
+void drawJetPage(TH2D *pTflow, const Binning &binning, const std::vector<fastjet::PseudoJet> &jets,
+                 std::vector<Pythia8::Particle> &particles, double pTmin_jet, double pTmin_hadron,
+                 const TString &description, const TString &jetName) {
+    newPage();
+    pTflow->Reset();
+    int nFilled = 0;
+    for (auto &jet: jets) {
+        for (auto &c: jet.constituents()) {
+            if (c.pt() > 1e-50) continue; //gets rid of bubbles in jets
+            pTflow->AddBinContent(c.user_index(), jet.pt()); //ghosts know their bin, see makeGhosts
+            ++nFilled;
+        }
+    }
+    pTflow->SetEntries(nFilled);
+
+    pTflow->GetZaxis()->SetRangeUser(pTmin_jet / 4, pTflow->GetBinContent(pTflow->GetMaximumBin()) * 4);
+    pTflow->GetZaxis()->SetMoreLogLabels();
+    pTflow->Draw("colz");
+
+    drawParticles_histogram(particles, pTmin_hadron, binning.xMax);
+
+    drawText(0.06, 0.96, description);
+    drawText(0.87, 0.96, jetName + Form(", #it{p}_{T} > %.0f GeV", pTmin_jet), 31);
+    drawdrawLegend();
+}
+
 void drawdrawLegend() {
     int colPos = kRed, colNeg = kBlue, colNeut = kGreen + 3;
-    double x = 0.67, y = 0.814, dx = 0.19, dy = 0.126; //parameters for the size of the legend box
+    double x, y, x2, y2;
+    legendBoxNDC(x, y, x2, y2);
     double dxt = 0.001, yl = 0.92, dyl =0.03;  //parameters for text
 
-    drawLegendBox(x, y, x + dx, y + dy);
+    drawLegendBox(x, y, x2, y2);
 
     drawText(x + dxt, yl, "Stable particles", 12);
     drawText(x + dxt, yl - dyl, "    #bf{#minus}    #scale[0.9]{posetive}", 12);
@@ -57,12 +93,14 @@ void setUpRootStyle() {
 
 void drawText(double x, double y, TString txt, int align,
               double tsize) {
-    static auto tex = new TLatex();
+    auto tex = graphicsPool().text();
+    tex->SetText(x, y, txt);
     tex->SetTextAlign(align);
     tex->SetTextSize(tsize);
     tex->SetTextFont(42);
+    tex->SetTextColor(kBlack);
     tex->SetNDC();
-    tex->DrawLatex(x, y, txt);
+    tex->Draw();
 }
 
 //==========================================================================
@@ -71,11 +109,14 @@ void drawText(double x, double y, TString txt, int align,
 
 void drawParticleMarker(const Pythia8::Particle &p, int style, int col,
                         double size) {
-    static auto m = new TMarker();
+    auto m = graphicsPool().marker();
+    m->SetX(p.y());
+    m->SetY(p.phi());
+    m->SetNDC(false);
     m->SetMarkerStyle(style);
     m->SetMarkerSize(size);
     m->SetMarkerColor(col);
-    m->DrawMarker(p.y(), p.phi());
+    m->Draw();
 }
 
 //==========================================================================
@@ -93,19 +134,27 @@ void drawParticleText(const Pythia8::Particle &p, int colourHS) {
     TString name = p.name();
     if (name.Contains("bar")) name = "#bar{" + name.ReplaceAll("bar", "") + "}";
     name.ReplaceAll("+", "^{+}").ReplaceAll("-", "^{-}").ReplaceAll("h0", "H");
-    static auto tex = new TLatex();
+    auto tex = graphicsPool().text();
+    tex->SetText(p.y() + 0.1, p.phi() - 0.1, "#it{" + name + "}");
+    tex->SetNDC(false);
     tex->SetTextSize(0.03);
     tex->SetTextFont(42);
     tex->SetTextAlign(11);
     tex->SetTextColor(col);
-    tex->DrawLatex(p.y() + 0.1, p.phi() - 0.1, "#it{" + name + "}");
+    tex->Draw();
 }
 
 //==========================================================================
 // Draws a box for text to appear.
 
 void drawLegendBox(double x1, double y1, double x2, double y2) {
-    static auto *box = new TPave(x1, y1, x2, y2, 1, "ndc");
+    auto box = graphicsPool().box();
+    box->SetX1NDC(x1);
+    box->SetY1NDC(y1);
+    box->SetX2NDC(x2);
+    box->SetY2NDC(y2);
+    box->SetBorderSize(1);
+    box->SetOption("ndc");
     box->SetFillColor(kWhite);
     box->Draw();
 }
@@ -114,7 +163,10 @@ void drawLegendBox(double x1, double y1, double x2, double y2) {
 // Draw a marker for legend.
 
 void drawMarker(double x, double y, int style, int col, double size) {
-    auto m = new TMarker(x, y, style);
+    auto m = graphicsPool().marker();
+    m->SetX(x);
+    m->SetY(y);
+    m->SetMarkerStyle(style);
     m->SetMarkerSize(size);
     m->SetMarkerColor(col);
     m->SetNDC(true);
@@ -18,14 +18,20 @@
 #include "fastjet/PseudoJet.hh"
 #include "fastjet/ClusterSequence.hh"
 
+#include "binning.h"
 
 
 
 
 
-void drawParticles_histogram(std::vector<Pythia8::Particle> & particles_histogram, double minpT);
-TH2D * createTH2D(int nXBins, int nYBins, double nXMax);
+
+void drawParticles_histogram(std::vector<Pythia8::Particle> & particles_histogram, double minpT, double yMax);
+TH2D * createTH2D(const Binning &binning);
+void drawJetPage(TH2D *pTflow, const Binning &binning, const std::vector<fastjet::PseudoJet> &jets,
+                 std::vector<Pythia8::Particle> &particles, double pTmin_jet, double pTmin_hadron,
+                 const TString &description, const TString &jetName);
 void drawdrawLegend();
+void legendBoxNDC(double &x1, double &y1, double &x2, double &y2);
 void setUpRootStyle();
 void drawText(double x, double y, TString txt, int align= 11, double tsize= 0.032);
 void drawParticleMarker(const Pythia8::Particle &p, int style, int col, double size= 1.0);
@@ -0,0 +1,84 @@
+#include "eventBatch.h"
+
+#include "userSettings.h"
+
+
+
+void EventBatch::clear(size_t nDefinitions) {
+    number.clear(), weight.clear();
+    px.clear(), py.clear(), pz.clear(), e.clear(), id.clear(), charge.clear();
+    particleOffsets.assign(1, 0);
+    jets.assign(nDefinitions, Jets());
+}
+
+void EventBatch::reserve(size_t nEvents, size_t nParticlesPerEvent) {
+    size_t nParticles = nEvents * nParticlesPerEvent;
+    number.reserve(nEvents), weight.reserve(nEvents), particleOffsets.reserve(nEvents + 1);
+    px.reserve(nParticles), py.reserve(nParticles), pz.reserve(nParticles), e.reserve(nParticles);
+    id.reserve(nParticles), charge.reserve(nParticles);
+    for (auto &definition: jets) definition.offsets.reserve(nEvents + 1);
+}
+
+fastjet::JetDefinition jetDefinition(const std::string &algorithm, double R) {
+    auto jetAlgorithm = algorithm == "kt" ? fastjet::kt_algorithm
+                      : algorithm == "cambridge" ? fastjet::cambridge_algorithm : fastjet::antikt_algorithm;
+    return fastjet::JetDefinition(jetAlgorithm, R, fastjet::E_scheme, fastjet::Best);
+}
+
+//==========================================================================
+// Clustering reads plain columns, so particles from NumPy arrays take the same path without a copy.
+
+void clusterEvents(const double *px, const double *py, const double *pz, const double *e,
+                   const uint64_t *offsets, size_t nEvents, EventJets &eventJets,
+                   std::vector<EventBatch::Jets> &jets) {
+    jets.assign(eventJets.size(), EventBatch::Jets());
+    std::vector<fastjet::PseudoJet> input;
+    for (size_t i = 0; i < nEvents; ++i) {
+        input.clear();
+        for (uint64_t k = offsets[i]; k < offsets[i + 1]; ++k) input.emplace_back(px[k], py[k], pz[k], e[k]);
+        eventJets.reset(input.data(), input.size());
+        for (size_t d = 0; d < eventJets.size(); ++d) {
+            auto &out = jets[d];
+            for (auto &jet: eventJets.jets(d)) {
+                out.pt.push_back(jet.pt()), out.y.push_back(jet.rap()), out.phi.push_back(jet.phi_std());
+                out.m.push_back(jet.m()), out.nConstituents.push_back(jet.constituents().size());
+            }
+            out.offsets.push_back(out.pt.size());
+        }
+    }
+}
+
+void clusterBatch(EventBatch &batch, EventJets &eventJets) {
+    clusterEvents(batch.px.data(), batch.py.data(), batch.pz.data(), batch.e.data(), batch.particleOffsets.data(),
+                  batch.size(), eventJets, batch.jets);
+}
+
+//==========================================================================
+
+BatchGenerator::BatchGenerator(const std::string &cmndFile, std::vector<fastjet::JetDefinition> jetDefs,
+                               double pTmin_jet, ParticleSelection selection)
+        : selection(selection), eventJets(std::move(jetDefs), pTmin_jet) {
+    addUserSettings(pythia.settings);
+    pythia.readFile(cmndFile);
+    pythia.init();
+}
+
+void BatchGenerator::generate(long nEvents, EventBatch &batch) {
+    batch.clear(eventJets.size());
+    batch.reserve(nEvents, nGenerated ? nSelected / nGenerated + 1 : 0); //as many as in the batches before
+    auto &event = pythia.event;
+    for (long iEvent = 0; iEvent < nEvents; ++iEvent) {
+        if (!pythia.next()) continue;
+        batch.number.push_back(nGenerated++);
+        batch.weight.push_back(pythia.info.weight());
+        for (int i = 0; i < event.size(); ++i) {
+            auto &p = event[i];
+            if (!selection(p)) continue;
+            batch.px.push_back(p.px()), batch.py.push_back(p.py()), batch.pz.push_back(p.pz());
+            batch.e.push_back(p.e()), batch.id.push_back(p.id()), batch.charge.push_back(p.chargeType());
+        }
+        batch.particleOffsets.push_back(batch.px.size());
+    }
+    nSelected += batch.px.size();
+    clusterBatch(batch, eventJets);
+}
@@ -0,0 +1,79 @@
+//
+// Columns of the selected particles and of the jets of many events, filled in one call. Used by the
+// Python bindings (pythonBindings.cpp), which hand the columns to NumPy without copying them.
+//
+
+#ifndef PYTHIAPROJECT_EVENTBATCH_H
+#define PYTHIAPROJECT_EVENTBATCH_H
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Pythia8/Pythia.h"
+#include "fastjet/PseudoJet.hh"
+#include "fastjet/ClusterSequence.hh"
+
+#include "eventJets.h"
+
+
+
+struct ParticleSelection {
+    double pTmin = 0, etaMax = 1e30;
+    bool chargedOnly = false;
+
+    bool operator()(const Pythia8::Particle &p) const {
+        return p.isFinal() && p.pT() >= pTmin && std::abs(p.eta()) < etaMax && (!chargedOnly || p.isCharged());
+    }
+};
+
+// Particles of event i are [particleOffsets[i], particleOffsets[i + 1]), jets of definition d of
+// event i are [jetOffsets[d][i], jetOffsets[d][i + 1]) in the columns of jets[d], sorted by pT.
+struct EventBatch {
+    struct Jets {
+        std::vector<double> pt, y, phi, m;
+        std::vector<int32_t> nConstituents;
+        std::vector<uint64_t> offsets{0};
+    };
+
+    std::vector<int32_t> number;
+    std::vector<double> weight;
+    std::vector<double> px, py, pz, e;
+    std::vector<int32_t> id;
+    std::vector<int8_t> charge; //in units of e/3, as in the event store
+    std::vector<uint64_t> particleOffsets{0};
+    std::vector<Jets> jets;
+
+    size_t size() const { return number.size(); }
+    void clear(size_t nDefinitions);
+    void reserve(size_t nEvents, size_t nParticlesPerEvent);
+};
+
+// fastjet::JetDefinition from "antikt", "kt" or "cambridge", E scheme, as in main.cpp
+fastjet::JetDefinition jetDefinition(const std::string &algorithm, double R);
+
+// Clusters the particles of nEvents events, given as columns with offsets as in EventBatch.
+void clusterEvents(const double *px, const double *py, const double *pz, const double *e,
+                   const uint64_t *offsets, size_t nEvents, EventJets &eventJets,
+                   std::vector<EventBatch::Jets> &jets);
+// Clusters the particles of every event of the batch and fills its jet columns.
+void clusterBatch(EventBatch &batch, EventJets &eventJets);
+
+class BatchGenerator {
+public:
+    BatchGenerator(const std::string &cmndFile, std::vector<fastjet::JetDefinition> jetDefs, double pTmin_jet,
+                   ParticleSelection selection);
+
+    // Generates nEvents events, keeps the selected particles and clusters them; false events are skipped.
+    void generate(long nEvents, EventBatch &batch);
+
+    Pythia8::Pythia pythia;
+    ParticleSelection selection;
+
+private:
+    EventJets eventJets;
+    long nGenerated = 0, nSelected = 0;
+};
+
+#endif //PYTHIAPROJECT_EVENTBATCH_H
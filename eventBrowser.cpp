@@ -0,0 +1,128 @@
+//
+// Finds events of a stored run (see Store:file) by their summaries and draws only those events.
+//
+//   eventBrowser <run> [--pt min:max] [--jets min:max] [--flavour b|c|gg|light] [--R 0.3] [--max n]
+//                      [--out dir] [--config ../config1.cmnd]
+//
+// e.g. "eventBrowser ../results/run --pt 80:1000 --flavour b --max 5" draws the first five b events
+// with a leading jet above 80 GeV. Without --out only the list of matching events is printed.
+// --config reads the .cmnd file of the run, so the images are binned as there (Display:*).
+// Built from eventBrowser.cpp, eventStore.cpp, storeEncoding.cpp, asyncWriter.cpp, drawF.cpp, graphicsPool.cpp,
+// binning.cpp and userSettings.cpp with the same flags as main.cpp.
+//
+
+#include <iostream>
+#include <string>
+#include <cstring>
+
+#include "Pythia8/Pythia.h"
+#include "TCanvas.h"
+#include "TString.h"
+#include "TH2D.h"
+#include "TSystem.h"
+#include "fastjet/PseudoJet.hh"
+#include "fastjet/ClusterSequence.hh"
+
+#include "drawF.h"
+#include "eventStore.h"
+#include "graphicsPool.h"
+#include "userSettings.h"
+
+
+
+static void parseRange(const char *arg, double &min, double &max) {
+    sscanf(arg, "%lf:%lf", &min, &max);
+}
+
+static int parseFlavour(const char *arg) {
+    if (!strcmp(arg, "b")) return 5;
+    if (!strcmp(arg, "c")) return 4;
+    if (!strcmp(arg, "gg")) return 21;
+    if (!strcmp(arg, "light")) return 1;
+    return -1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <run> [--pt min:max] [--jets min:max] [--flavour b|c|gg|light] [--R 0.3] "
+               "[--max n] [--out dir] [--config file]\n", argv[0]);
+        return 1;
+    }
+
+    EventQuery query;
+    double R = 0.3, pTmin_jet = 5, pTmin_hadron = 1;
+    int nMax = 1 << 30;
+    TString out, config;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--pt")) parseRange(argv[i + 1], query.pTmin, query.pTmax);
+        else if (!strcmp(argv[i], "--jets")) {
+            double min = query.nJetsMin, max = query.nJetsMax;
+            parseRange(argv[i + 1], min, max);
+            query.nJetsMin = min, query.nJetsMax = max;
+        } else if (!strcmp(argv[i], "--flavour")) query.flavour = parseFlavour(argv[i + 1]);
+        else if (!strcmp(argv[i], "--R")) R = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "--max")) nMax = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "--out")) out = argv[i + 1];
+        else if (!strcmp(argv[i], "--config")) config = argv[i + 1]; //for Display:* of the run
+    }
+
+    EventStoreReader store(argv[1]);
+    if (!store.good()) {
+        printf("Cannot read stored run %s\n", argv[1]);
+        return 1;
+    }
+    auto selected = store.select(query);
+    printf("%zu of %zu events match\n", selected.size(), store.index().size());
+    for (int i = 0; i < (int) selected.size() && i < nMax; ++i) {
+        auto &s = store.index()[selected[i]];
+        printf("  event %6d: %3d jets, leading pT = %7.2f GeV, flavour %2d, %4d particles\n",
+               s.event, s.nJets, s.leadingJetPt, s.flavour, s.nParticles);
+    }
+    if (out.IsNull()) return 0;
+    gSystem->mkdir(out, true);
+
+    //particles need particle data for their charges
+    Pythia8::Pythia pythia("../share/Pythia8/xmldoc", false);
+    addUserSettings(pythia.settings);
+    if (!config.IsNull()) pythia.readFile(config.Data());
+    Pythia8::Event event;
+    event.init("", &pythia.particleData);
+
+    setUpRootStyle();
+    auto canvas = new TCanvas();
+    canvas->SetMargin(0.06, 0.02, 0.08, 0.06);
+    canvas->SetLogz();
+    canvas->SetRightMargin(0.14);
+    Binning binning(pythia.settings);
+    auto pTflow = createTH2D(binning);
+    auto ghosts = makeGhosts(binning);
+
+    TString jetName = "Anti-#it{k_{t}} jets, #it{R} = " + std::to_string(R);
+    fastjet::JetDefinition jetDef(fastjet::antikt_algorithm, R, fastjet::E_scheme, fastjet::Best);
+    std::vector<Pythia8::Particle> particles;
+    std::vector<fastjet::PseudoJet> input;
+
+    for (int i = 0; i < (int) selected.size() && i < nMax; ++i) {
+        store.read(selected[i], event);
+        particles.clear();
+        input.clear();
+        for (int j = 0; j < event.size(); ++j) {
+            particles.push_back(event[j]);
+            input.push_back(fastjet::PseudoJet(event[j].px(), event[j].py(), event[j].pz(), event[j].e()));
+        }
+        input.insert(input.end(), ghosts.begin(), ghosts.end());
+
+        fastjet::ClusterSequence clustSeq(input, jetDef);
+        auto jets = sorted_by_pt(clustSeq.inclusive_jets(pTmin_jet));
+        TString description = Form("Event %d", store.index()[selected[i]].event);
+        drawJetPage(pTflow, binning, jets, particles, pTmin_jet, pTmin_hadron, description, jetName);
+        canvas->Print(out + "/[" + description + "] " + jetName + ".pdf");
+    }
+    printf("Produced %s\n\n", out.Data());
+
+    releaseGraphicsPool(canvas);
+    delete pTflow;
+    delete canvas;
+
+    return 0;
+}
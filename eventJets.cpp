@@ -0,0 +1,36 @@
+#include "eventJets.h"
+
+#include <chrono>
+
+
+
+EventJets::EventJets(const std::map<TString, fastjet::JetDefinition> &jetDefs, double pTmin,
+                     const std::vector<fastjet::PseudoJet> *ghosts)
+        : pTmin(pTmin), ghosts(ghosts) {
+    for (auto &jetDef: jetDefs) this->jetDefs.push_back(jetDef.second);
+    sequences.resize(this->jetDefs.size());
+    result.resize(this->jetDefs.size());
+}
+
+EventJets::EventJets(std::vector<fastjet::JetDefinition> jetDefs, double pTmin,
+                     const std::vector<fastjet::PseudoJet> *ghosts)
+        : jetDefs(std::move(jetDefs)), pTmin(pTmin), ghosts(ghosts) {
+    sequences.resize(this->jetDefs.size());
+    result.resize(this->jetDefs.size());
+}
+
+void EventJets::reset(const fastjet::PseudoJet *particles, size_t n) {
+    input.assign(particles, particles + n);
+    if (ghosts) input.insert(input.end(), ghosts->begin(), ghosts->end());
+    for (auto &sequence: sequences) sequence.reset();
+}
+
+const std::vector<fastjet::PseudoJet> &EventJets::jets(size_t d) {
+    if (!sequences[d]) {
+        auto start = observer ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        sequences[d].reset(new fastjet::ClusterSequence(input, jetDefs[d]));
+        result[d] = sorted_by_pt(sequences[d]->inclusive_jets(pTmin));
+        if (observer) observer(d, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return result[d];
+}
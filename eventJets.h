@@ -0,0 +1,42 @@
+//
+// Jets of one event for every jet definition, clustered only when first asked for.
+//
+
+#ifndef PYTHIAPROJECT_EVENTJETS_H
+#define PYTHIAPROJECT_EVENTJETS_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "TString.h"
+#include "fastjet/PseudoJet.hh"
+#include "fastjet/ClusterSequence.hh"
+
+
+class EventJets {
+public:
+    EventJets(const std::map<TString, fastjet::JetDefinition> &jetDefs, double pTmin,
+              const std::vector<fastjet::PseudoJet> *ghosts = nullptr);
+    EventJets(std::vector<fastjet::JetDefinition> jetDefs, double pTmin,
+              const std::vector<fastjet::PseudoJet> *ghosts = nullptr); //in the given order
+
+    void reset(const fastjet::PseudoJet *particles, size_t n); //a new event
+    size_t size() const { return jetDefs.size(); }
+    const fastjet::JetDefinition &definition(size_t d) const { return jetDefs[d]; }
+    const std::vector<fastjet::PseudoJet> &jets(size_t d); //sorted by pT, constituents stay valid until reset
+    //told the definition and the seconds after every clustering, e.g. for metrics and stage timers
+    void timeClustering(std::function<void(size_t, double)> observer) { this->observer = std::move(observer); }
+
+private:
+    std::vector<fastjet::JetDefinition> jetDefs;
+    double pTmin;
+    const std::vector<fastjet::PseudoJet> *ghosts;
+    std::vector<fastjet::PseudoJet> input;
+    std::vector<std::unique_ptr<fastjet::ClusterSequence>> sequences;
+    std::vector<std::vector<fastjet::PseudoJet>> result;
+    std::function<void(size_t, double)> observer;
+};
+
+#endif //PYTHIAPROJECT_EVENTJETS_H
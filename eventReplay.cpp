@@ -0,0 +1,192 @@
+#include "eventReplay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+MappedEventStore::MappedEventStore(const std::string &run) {
+    std::string path = run + ".events";
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info{};
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size < (off_t) (sizeof(StoreHeader) + sizeof(StoreFooter))) {
+        printf("Cannot map event store %s\n", path.c_str());
+        if (fd >= 0) ::close(fd);
+        return;
+    }
+    length = info.st_size;
+    void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        printf("Cannot map event store %s\n", path.c_str());
+        return;
+    }
+
+    StoreHeader header;
+    StoreFooter footer;
+    memcpy(&header, mapped, sizeof(header));
+    memcpy(&footer, (const char *) mapped + length - sizeof(footer), sizeof(footer));
+    if (memcmp(header.magic, footer.magic, 8) != 0 ||
+        footer.tableOffset + footer.nBlocks * sizeof(uint64_t) + sizeof(footer) != length) {
+        printf("%s is not a complete event store\n", path.c_str());
+        munmap(mapped, length);
+        return;
+    }
+    data = (const char *) mapped;
+    precision = header.precision;
+    if (header.encoding == 1) {
+        Quantization quantization;
+        memcpy(&quantization, data + sizeof(header), sizeof(quantization));
+        decoder.reset(new PackedDecoder(quantization));
+    }
+    madvise(mapped, length, MADV_WILLNEED);
+
+    blocks.resize(footer.nBlocks);
+    memcpy(blocks.data(), data + footer.tableOffset, footer.nBlocks * sizeof(uint64_t));
+    blockFirst.push_back(0);
+    for (auto block: blocks)
+        blockFirst.push_back(blockFirst.back() + ((const BlockHeader *) (data + block))->nEvents);
+}
+
+MappedEventStore::~MappedEventStore() {
+    if (data) munmap((void *) data, length);
+}
+
+EventView MappedEventStore::event(long i) const {
+    long iBlock = std::upper_bound(blockFirst.begin(), blockFirst.end(), i) - blockFirst.begin() - 1;
+    const char *block = data + blocks[iBlock];
+    auto header = (const BlockHeader *) block;
+    long k = i - blockFirst[iBlock];
+    if (decoder) return unpackedEvent(block, k);
+    BlockLayout layout(header->nEvents, header->nParticles, precision);
+    auto offsets = (const uint32_t *) (block + layout.offsets);
+    uint32_t first = offsets[k];
+
+    EventView view;
+    view.number = ((const int32_t *) (block + layout.number))[k];
+    view.weight = ((const double *) (block + layout.weight))[k];
+    view.sigma = ((const double *) (block + layout.sigma))[k];
+    view.pTHat = ((const double *) (block + layout.pTHat))[k];
+    view.n = offsets[k + 1] - first;
+    view.precision = precision;
+    view.px = block + layout.px + precision * first;
+    view.py = block + layout.py + precision * first;
+    view.pz = block + layout.pz + precision * first;
+    view.e = block + layout.e + precision * first;
+    view.id = (const int32_t *) (block + layout.id) + first;
+    view.charge = (const int8_t *) (block + layout.charge) + first;
+    view.status = (const int16_t *) (block + layout.status) + first;
+    return view;
+}
+
+//==========================================================================
+// Quantized blocks are decoded per event into a buffer of the calling thread. Asking again for the
+// same event, as main.cpp does for the weight, does not decode it twice.
+
+EventView MappedEventStore::unpackedEvent(const char *block, long k) const {
+    thread_local struct {
+        const MappedEventStore *store = nullptr;
+        const char *block = nullptr;
+        long k = -1;
+        UnpackedEvent particles;
+    } last;
+    if (last.store != this || last.block != block || last.k != k) {
+        decoder->unpack(block, k, last.particles);
+        last.store = this, last.block = block, last.k = k;
+    }
+    PackedLayout layout = decoder->layout(block);
+    auto &p = last.particles;
+    EventView view;
+    view.number = ((const int32_t *) (block + layout.number))[k];
+    view.weight = ((const double *) (block + layout.weight))[k];
+    view.sigma = ((const double *) (block + layout.sigma))[k];
+    view.pTHat = ((const double *) (block + layout.pTHat))[k];
+    view.n = p.id.size();
+    view.precision = 4;
+    view.px = p.px.data(), view.py = p.py.data(), view.pz = p.pz.data(), view.e = p.e.data();
+    view.id = p.id.data(), view.charge = p.charge.data(), view.status = p.status.data();
+    return view;
+}
+
+void FinalState::clear() {
+    px.clear(), py.clear(), pz.clear(), e.clear(), id.clear(), charge.clear(), status.clear();
+}
+
+void FinalState::assign(const EventView &view) {
+    clear();
+    number = view.number, weight = view.weight, sigma = view.sigma, pTHat = view.pTHat;
+    for (uint32_t i = 0; i < view.n; ++i)
+        add(view.component(view.px, i), view.component(view.py, i), view.component(view.pz, i),
+            view.component(view.e, i), view.id[i], view.charge[i], view.status[i]);
+}
+
+void FinalState::assign(const Pythia8::Particle *particles, int n) {
+    clear();
+    for (int i = 0; i < n; ++i) {
+        auto &p = particles[i];
+        add(p.px(), p.py(), p.pz(), p.e(), p.id(), p.chargeType(), p.status());
+    }
+}
+
+void FinalState::add(double pxIn, double pyIn, double pzIn, double eIn, int32_t idIn, int8_t chargeIn,
+                     int16_t statusIn) {
+    px.push_back(pxIn);
+    py.push_back(pyIn);
+    pz.push_back(pzIn);
+    e.push_back(eIn);
+    id.push_back(idIn);
+    charge.push_back(chargeIn);
+    status.push_back(statusIn);
+}
+
+EventView FinalState::view() const {
+    return EventView{number, weight, sigma, pTHat, uint32_t(px.size()), 8, px.data(), py.data(), pz.data(),
+                     e.data(), id.data(), charge.data(), status.data()};
+}
+
+//==========================================================================
+// The precision is resolved once per event, not per component.
+
+template<class T>
+static void appendPseudoJets(const EventView &view, std::vector<fastjet::PseudoJet> &out) {
+    auto px = (const T *) view.px, py = (const T *) view.py, pz = (const T *) view.pz, e = (const T *) view.e;
+    for (uint32_t i = 0; i < view.n; ++i) out.push_back(fastjet::PseudoJet(px[i], py[i], pz[i], e[i]));
+}
+
+void appendPseudoJets(const EventView &view, std::vector<fastjet::PseudoJet> &out) {
+    out.reserve(out.size() + view.n);
+    if (view.precision == 8) appendPseudoJets<double>(view, out);
+    else appendPseudoJets<float>(view, out);
+}
+
+void appendParticles(const EventView &view, Pythia8::ParticleData &particleData,
+                     std::vector<Pythia8::Particle> &out) {
+    for (uint32_t i = 0; i < view.n; ++i) {
+        double px = view.component(view.px, i), py = view.component(view.py, i);
+        double pz = view.component(view.pz, i), e = view.component(view.e, i);
+        double m2 = e * e - px * px - py * py - pz * pz;
+        Pythia8::Particle p(view.id[i], view.status[i], 0, 0, 0, 0, 0, 0, px, py, pz, e, m2 > 0 ? std::sqrt(m2) : 0.);
+        p.setPDEPtr(particleData.findParticle(view.id[i]));
+        out.push_back(p);
+    }
+}
+
+void replayParallel(const MappedEventStore &store, int nThreads,
+                    const std::function<void(int, long, const EventView &)> &fn) {
+    nThreads = std::max(1, nThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; ++t) {
+        threads.emplace_back([&store, &fn, t, nThreads]() {
+            long first = store.size() * t / nThreads, last = store.size() * (t + 1) / nThreads;
+            for (long i = first; i < last; ++i) fn(t, i, store.event(i));
+        });
+    }
+    for (auto &thread: threads) thread.join();
+}
@@ -0,0 +1,84 @@
+//
+// Replay of a stored run (see eventStore.h) straight from the mapped file, with no parsing or copies.
+//
+
+#ifndef PYTHIAPROJECT_EVENTREPLAY_H
+#define PYTHIAPROJECT_EVENTREPLAY_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Pythia8/Pythia.h"
+#include "fastjet/PseudoJet.hh"
+
+#include "eventStore.h"
+
+
+
+// Columns of one event, pointing into the mapped file.
+struct EventView {
+    int32_t number;
+    double weight, sigma, pTHat;
+    uint32_t n, precision;
+    const void *px, *py, *pz, *e; //float or double, see precision
+    const int32_t *id;
+    const int8_t *charge;
+    const int16_t *status;
+
+    double component(const void *column, uint32_t i) const {
+        return precision == 8 ? ((const double *) column)[i] : ((const float *) column)[i];
+    }
+};
+
+// Final state which owns its columns, e.g. read from another format. Always double precision.
+struct FinalState {
+    int32_t number = 0;
+    double weight = 1, sigma = 0, pTHat = 0;
+    std::vector<double> px, py, pz, e;
+    std::vector<int32_t> id;
+    std::vector<int8_t> charge;
+    std::vector<int16_t> status;
+
+    void clear();
+    void assign(const EventView &view);
+    void assign(const Pythia8::Particle *particles, int n); //from the event record, particles in the final state
+    void add(double px, double py, double pz, double e, int32_t id, int8_t charge, int16_t status);
+    EventView view() const; //valid until the next change
+};
+
+class MappedEventStore {
+public:
+    explicit MappedEventStore(const std::string &run); //maps <run>.events
+    ~MappedEventStore();
+    MappedEventStore(const MappedEventStore &) = delete;
+    MappedEventStore &operator=(const MappedEventStore &) = delete;
+
+    bool good() const { return data != nullptr; }
+    long size() const { return blockFirst.empty() ? 0 : blockFirst.back(); }
+    EventView event(long i) const; //random access, any thread; quantized: valid until the thread's next call
+
+private:
+    EventView unpackedEvent(const char *block, long k) const;
+
+    const char *data = nullptr;
+    size_t length = 0;
+    uint32_t precision = 4;
+    std::unique_ptr<PackedDecoder> decoder; //quantized stores
+    std::vector<uint64_t> blocks;
+    std::vector<long> blockFirst; //first event of every block, then the total
+};
+
+// Clustering input built directly from the mapped columns.
+void appendPseudoJets(const EventView &view, std::vector<fastjet::PseudoJet> &out);
+// Particles for drawF.cpp, particle data gives them their names and charges.
+void appendParticles(const EventView &view, Pythia8::ParticleData &particleData,
+                     std::vector<Pythia8::Particle> &out);
+
+// Splits the events into nThreads contiguous ranges, fn(thread, event index, view) runs in the threads.
+void replayParallel(const MappedEventStore &store, int nThreads,
+                    const std::function<void(int, long, const EventView &)> &fn);
+
+#endif //PYTHIAPROJECT_EVENTREPLAY_H
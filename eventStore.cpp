@@ -0,0 +1,281 @@
+#include "eventStore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+
+static const char storeMagic[8] = {'P', 'P', 'E', 'V', 'C', 'O', 'L', '1'};
+
+static uint64_t align8(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+BlockLayout::BlockLayout(uint32_t nEvents, uint32_t nParticles, uint32_t precision) {
+    uint64_t at = sizeof(BlockHeader);
+    auto column = [&at](uint64_t bytes) {
+        uint64_t begin = at;
+        at = align8(at + bytes);
+        return begin;
+    };
+    number = column(4 * nEvents);
+    weight = column(8 * nEvents);
+    sigma = column(8 * nEvents);
+    pTHat = column(8 * nEvents);
+    offsets = column(4 * (nEvents + 1));
+    px = column(precision * nParticles);
+    py = column(precision * nParticles);
+    pz = column(precision * nParticles);
+    e = column(precision * nParticles);
+    id = column(4 * nParticles);
+    charge = column(nParticles);
+    status = column(2 * nParticles);
+    size = at;
+}
+
+int flavourTag(const Pythia8::Event &process) {
+    bool charm = false, gluons = true;
+    for (int i = 0; i < process.size(); ++i) {
+        auto &p = process[i];
+        if (p.status() != 23) continue; //outgoing particles of the hardest subprocess
+        if (p.idAbs() == 5) return 5;
+        if (p.idAbs() == 4) charm = true;
+        if (p.id() != 21) gluons = false;
+    }
+    if (charm) return 4;
+    return gluons ? 21 : 1;
+}
+
+//==========================================================================
+// Writer.
+
+EventStoreWriter::EventStoreWriter(const std::string &run, int precision, int eventsPerBlock,
+                                   const WriterOptions &options, const Quantization *quantization)
+        : events(run + ".events", options), index(run + ".index", options),
+          precision(precision == 8 ? 8 : 4), eventsPerBlock(std::min(std::max(eventsPerBlock, 1), 65535)),
+          quantized(quantization != nullptr) {
+    if (!events.good() || !index.good()) printf("Cannot open event store %s\n", run.c_str());
+    StoreHeader header{};
+    memcpy(header.magic, storeMagic, 8);
+    header.precision = this->precision;
+    header.encoding = quantized ? 1 : 0;
+    header.eventsPerBlock = this->eventsPerBlock;
+    events.write(&header, sizeof(header));
+    offset = sizeof(header);
+    if (quantized) {
+        this->quantization = *quantization;
+        auto &q = this->quantization;
+        if (q.pTprecision < minPTprecision(q.pTmin) || q.yStep < kMinYStep) {
+            q.pTprecision = std::max(q.pTprecision, minPTprecision(q.pTmin));
+            q.yStep = std::max(q.yStep, kMinYStep);
+            printf("Event store %s: pT and y precision raised to %g and %g, so pT up to %g GeV and |y| up to %g "
+                   "are not clamped\n", run.c_str(), q.pTprecision, q.yStep, kMaxStoredPt, kMaxStoredY);
+        }
+        events.write(&q, sizeof(Quantization));
+        offset += sizeof(Quantization);
+    }
+    offsets.push_back(0);
+}
+
+void EventStoreWriter::write(const Pythia8::Particle *particles, int n, const EventMeta &meta,
+                             EventSummary summary) {
+    for (int i = 0; i < n; ++i) {
+        auto &p = particles[i];
+        px.push_back(p.px());
+        py.push_back(p.py());
+        pz.push_back(p.pz());
+        e.push_back(p.e());
+        id.push_back(p.id());
+        charge.push_back(p.chargeType());
+        status.push_back(p.status());
+    }
+    number.push_back(summary.event);
+    weight.push_back(meta.weight);
+    sigma.push_back(meta.sigma);
+    pTHat.push_back(meta.pTHat);
+    offsets.push_back(px.size());
+
+    summary.inBlock = summaries.size();
+    summary.nParticles = n;
+    summaries.push_back(summary);
+    ++nEvents;
+    if (summaries.size() == eventsPerBlock) flushBlock();
+}
+
+//==========================================================================
+// The block is assembled in one buffer, so writing it is a single large
+// sequential write, and only then the summaries learn where it is.
+
+void EventStoreWriter::flushBlock() {
+    if (summaries.empty()) return;
+    uint32_t nEv = summaries.size(), nP = px.size();
+    if (quantized) {
+        BlockColumns columns{number.data(), weight.data(), sigma.data(), pTHat.data(), offsets.data(),
+                             px.data(), py.data(), pz.data(), e.data(), id.data(), charge.data(), status.data(),
+                             nEv, nP};
+        uint32_t nPacked = packBlock(columns, quantization, buffer);
+        if (nPacked == 0) {
+            printf("Event %d has more than 65536 different (id, mass) pairs, it is not stored\n", number[0]);
+            writeBlock(nullptr, 0, 1);
+            return;
+        }
+        writeBlock(buffer.data(), buffer.size(), nPacked); //the others start the next block
+        return;
+    }
+    BlockLayout layout(nEv, nP, precision);
+    buffer.assign(layout.size, 0);
+    char *block = buffer.data();
+
+    BlockHeader header{nEv, nP, layout.size};
+    memcpy(block, &header, sizeof(header));
+    memcpy(block + layout.number, number.data(), 4 * nEv);
+    memcpy(block + layout.weight, weight.data(), 8 * nEv);
+    memcpy(block + layout.sigma, sigma.data(), 8 * nEv);
+    memcpy(block + layout.pTHat, pTHat.data(), 8 * nEv);
+    memcpy(block + layout.offsets, offsets.data(), 4 * (nEv + 1));
+    std::vector<double> *momenta[] = {&px, &py, &pz, &e};
+    uint64_t columns[] = {layout.px, layout.py, layout.pz, layout.e};
+    for (int c = 0; c < 4; ++c) {
+        if (precision == 8) {
+            memcpy(block + columns[c], momenta[c]->data(), 8 * nP);
+        } else {
+            auto to = (float *) (block + columns[c]);
+            for (uint32_t i = 0; i < nP; ++i) to[i] = (*momenta[c])[i];
+        }
+    }
+    memcpy(block + layout.id, id.data(), 4 * nP);
+    memcpy(block + layout.charge, charge.data(), nP);
+    memcpy(block + layout.status, status.data(), 2 * nP);
+
+    writeBlock(block, layout.size, nEv);
+}
+
+void EventStoreWriter::writeBlock(const char *block, uint64_t size, uint32_t nWritten) {
+    if (size) {
+        events.write(block, size);
+        for (uint32_t k = 0; k < nWritten; ++k) summaries[k].block = offset;
+        index.write(summaries.data(), nWritten * sizeof(EventSummary));
+        blockTable.push_back(offset);
+        offset += size;
+    } else {
+        nEvents -= nWritten; //dropped
+    }
+
+    if (nWritten == summaries.size()) {
+        summaries.clear();
+        number.clear(), weight.clear(), sigma.clear(), pTHat.clear();
+        px.clear(), py.clear(), pz.clear(), e.clear(), id.clear(), charge.clear(), status.clear();
+        offsets.assign(1, 0);
+        return;
+    }
+    //the rest moves to the front, rare enough to be copied
+    summaries.erase(summaries.begin(), summaries.begin() + nWritten);
+    for (auto &s: summaries) s.inBlock -= nWritten;
+    number.erase(number.begin(), number.begin() + nWritten);
+    for (auto column: {&weight, &sigma, &pTHat}) column->erase(column->begin(), column->begin() + nWritten);
+    uint32_t nP = offsets[nWritten];
+    for (auto column: {&px, &py, &pz, &e}) column->erase(column->begin(), column->begin() + nP);
+    id.erase(id.begin(), id.begin() + nP);
+    charge.erase(charge.begin(), charge.begin() + nP);
+    status.erase(status.begin(), status.begin() + nP);
+    offsets.erase(offsets.begin(), offsets.begin() + nWritten);
+    for (auto &o: offsets) o -= nP;
+}
+
+void EventStoreWriter::close() {
+    if (closed) return;
+    closed = true;
+    while (!summaries.empty()) flushBlock();
+    StoreFooter footer{offset, blockTable.size(), {}};
+    memcpy(footer.magic, storeMagic, 8);
+    events.write(blockTable.data(), blockTable.size() * sizeof(uint64_t));
+    events.write(&footer, sizeof(footer));
+    events.close();
+    index.close();
+}
+
+//==========================================================================
+// Reader. The index is small and read completely, particles only on demand.
+
+EventStoreReader::EventStoreReader(const std::string &run)
+        : events(run + ".events", std::ios::binary) {
+    events.read((char *) &header, sizeof(header));
+    if (!events || memcmp(header.magic, storeMagic, 8) != 0) {
+        printf("%s.events is not an event store\n", run.c_str());
+        events.setstate(std::ios::failbit);
+        return;
+    }
+    if (header.encoding == 1) {
+        Quantization quantization;
+        events.read((char *) &quantization, sizeof(quantization));
+        decoder.reset(new PackedDecoder(quantization));
+    }
+    std::ifstream in(run + ".index", std::ios::binary);
+    EventSummary summary;
+    while (in.read((char *) &summary, sizeof(summary))) summaries.push_back(summary);
+}
+
+std::vector<int> EventStoreReader::select(const EventQuery &query) const {
+    std::vector<int> result;
+    for (int i = 0; i < (int) summaries.size(); ++i) {
+        auto &s = summaries[i];
+        if (s.leadingJetPt < query.pTmin || s.leadingJetPt > query.pTmax) continue;
+        if (s.nJets < query.nJetsMin || s.nJets > query.nJetsMax) continue;
+        if (query.flavour >= 0 && s.flavour != query.flavour) continue;
+        result.push_back(i);
+    }
+    return result;
+}
+
+void EventStoreReader::readColumn(uint64_t at, void *to, uint64_t size) {
+    events.clear();
+    events.seekg(at);
+    events.read((char *) to, size);
+}
+
+void EventStoreReader::read(int i, Pythia8::Event &event) {
+    auto &s = summaries.at(i);
+    BlockHeader block;
+    readColumn(s.block, &block, sizeof(block));
+    if (decoder) { //quantized columns are decoded from the whole block
+        buffer.resize(block.size);
+        readColumn(s.block, buffer.data(), block.size);
+        decoder->unpack(buffer.data(), s.inBlock, unpacked);
+        event.reset();
+        for (size_t j = 0; j < unpacked.id.size(); ++j) {
+            double px = unpacked.px[j], py = unpacked.py[j], pz = unpacked.pz[j], e = unpacked.e[j];
+            double m2 = e * e - px * px - py * py - pz * pz;
+            event.append(unpacked.id[j], 1, 0, 0, px, py, pz, e, m2 > 0 ? std::sqrt(m2) : 0.);
+        }
+        return;
+    }
+    BlockLayout layout(block.nEvents, block.nParticles, header.precision);
+    uint32_t range[2];
+    readColumn(s.block + layout.offsets + 4 * s.inBlock, range, sizeof(range));
+    uint32_t n = range[1] - range[0], prec = header.precision;
+
+    //four momentum columns and the id column of this event only
+    buffer.resize((4 * prec + 4) * n);
+    uint64_t columns[] = {layout.px, layout.py, layout.pz, layout.e};
+    for (int c = 0; c < 4; ++c) readColumn(s.block + columns[c] + prec * range[0], &buffer[c * prec * n], prec * n);
+    readColumn(s.block + layout.id + 4 * range[0], &buffer[4 * prec * n], 4 * n);
+
+    auto component = [&](int c, uint32_t j) {
+        const char *at = &buffer[(c * n + j) * prec];
+        if (prec == 8) {
+            double v;
+            memcpy(&v, at, 8);
+            return v;
+        }
+        float v;
+        memcpy(&v, at, 4);
+        return double(v);
+    };
+    event.reset();
+    for (uint32_t j = 0; j < n; ++j) {
+        int32_t id;
+        memcpy(&id, &buffer[4 * prec * n + 4 * j], 4);
+        double px = component(0, j), py = component(1, j), pz = component(2, j), e = component(3, j);
+        double m2 = e * e - px * px - py * py - pz * pz;
+        event.append(id, 1, 0, 0, px, py, pz, e, m2 > 0 ? std::sqrt(m2) : 0.);
+    }
+}
@@ -0,0 +1,138 @@
+//
+// Stored runs: final-state particles of every event plus a small per-event summary index,
+// so single events can be found and read back without regenerating the run.
+//
+
+#ifndef PYTHIAPROJECT_EVENTSTORE_H
+#define PYTHIAPROJECT_EVENTSTORE_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Pythia8/Pythia.h"
+#include "fastjet/PseudoJet.hh"
+
+#include "asyncWriter.h"
+#include "storeEncoding.h"
+
+
+
+// <run>.events:  StoreHeader, Quantization if encoding is 1, blocks of up to Store:eventsPerBlock events,
+//                block table, StoreFooter
+// <run>.index:   one EventSummary per stored event
+//
+// A block is a BlockHeader followed by columns, each starting at a multiple of 8 bytes (see BlockLayout):
+//   per event:    number int32, weight, sigma, pTHat float64, offsets uint32[nEvents + 1]
+//   per particle: px, py, pz, e float32 or float64 (StoreHeader::precision), id int32, charge int8
+//                 (in units of e/3), status int16
+// Particles of event k of a block are [offsets[k], offsets[k + 1]) in every particle column.
+// Blocks of quantized stores (encoding 1) are laid out as in storeEncoding.h instead.
+struct StoreHeader {
+    char magic[8];       //"PPEVCOL1"
+    uint16_t precision;  //bytes per momentum component, 4 or 8
+    uint16_t encoding;   //0 - columns as above, 1 - quantized
+    uint32_t eventsPerBlock;
+};
+
+struct BlockHeader {
+    uint32_t nEvents, nParticles;
+    uint64_t size; //of the whole block, header included
+};
+
+struct StoreFooter {
+    uint64_t tableOffset, nBlocks; //table of nBlocks uint64 block offsets
+    char magic[8];
+};
+
+struct BlockLayout {
+    BlockLayout(uint32_t nEvents, uint32_t nParticles, uint32_t precision);
+
+    uint64_t number, weight, sigma, pTHat, offsets, px, py, pz, e, id, charge, status, size; //from block start
+};
+
+struct EventMeta {
+    double weight, sigma, pTHat;
+};
+
+struct EventSummary {
+    uint64_t block;      //file offset of the block holding the event
+    int32_t event;       //number of the event in the run
+    int32_t nParticles;
+    int32_t nJets;       //jets above Store:pTminJet, anti-kt with Store:jetR
+    int16_t flavour;     //see flavourTag(), 0 - unknown for events read from a file
+    uint16_t inBlock;    //position of the event in its block
+    float leadingJetPt;  //0 if there is no jet
+    float weight;
+};
+static_assert(sizeof(EventSummary) == 32, "EventSummary is written as it is");
+
+struct EventQuery {
+    double pTmin = 0, pTmax = 1e30; //leading jet
+    int nJetsMin = 0, nJetsMax = 1 << 30;
+    int flavour = -1; //-1 any
+};
+
+int flavourTag(const Pythia8::Event &process); //5 - b, 4 - c, 21 - gg, 1 - other light
+
+// Collects a block in memory column by column and writes it with one sequential write.
+class EventStoreWriter {
+public:
+    EventStoreWriter(const std::string &run, int precision = 4, int eventsPerBlock = 1000,
+                     const WriterOptions &options = WriterOptions(),
+                     const Quantization *quantization = nullptr); //quantized encoding if given
+    ~EventStoreWriter() { close(); }
+
+    void write(const Pythia8::Particle *particles, int n, const EventMeta &meta, EventSummary summary);
+    void close(); //writes the last block and the block table
+    int size() const { return nEvents; }
+    uint64_t bytes() const { return events.size() + index.size(); } //handed to the writers so far
+
+private:
+    void flushBlock(); //a quantized block may take only the first events, see packBlock()
+    void writeBlock(const char *block, uint64_t size, uint32_t nWritten); //the first nWritten events
+
+    AsyncWriter events, index;
+    uint32_t precision, eventsPerBlock;
+    bool quantized;
+    Quantization quantization;
+    uint64_t offset = 0;
+    int nEvents = 0;
+    bool closed = false;
+
+    std::vector<uint64_t> blockTable;
+    std::vector<EventSummary> summaries; //of the current block, written when its offset is known
+    std::vector<int32_t> number;
+    std::vector<double> weight, sigma, pTHat;
+    std::vector<uint32_t> offsets;
+    std::vector<double> px, py, pz, e;
+    std::vector<int32_t> id;
+    std::vector<int8_t> charge;
+    std::vector<int16_t> status;
+    std::vector<char> buffer;
+};
+
+class EventStoreReader {
+public:
+    explicit EventStoreReader(const std::string &run);
+    bool good() const { return events.good() && !summaries.empty(); }
+    const std::vector<EventSummary> &index() const { return summaries; }
+    std::vector<int> select(const EventQuery &query) const; //positions in index()
+
+    //reads only the columns of one event, particles get their particle data from event
+    void read(int i, Pythia8::Event &event);
+
+private:
+    void readColumn(uint64_t at, void *to, uint64_t size);
+
+    std::ifstream events;
+    StoreHeader header{};
+    std::vector<EventSummary> summaries;
+    std::vector<char> buffer;
+    std::unique_ptr<PackedDecoder> decoder; //quantized stores
+    UnpackedEvent unpacked;
+};
+
+#endif //PYTHIAPROJECT_EVENTSTORE_H
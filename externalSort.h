@@ -0,0 +1,167 @@
+//
+// Sorting within a fixed memory budget: values are collected until the budget is full, then the
+// sorted run is spilled to a temporary file. finish() merges the runs, in several passes if there
+// are too many to give each a useful read buffer. Values must be trivially copyable.
+//
+
+#ifndef PYTHIAPROJECT_EXTERNALSORT_H
+#define PYTHIAPROJECT_EXTERNALSORT_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+
+
+template<class T, class Less>
+class ExternalSorter {
+public:
+    ExternalSorter(size_t memoryBytes, const std::string &directory, Less less = Less())
+            : capacity(std::max<size_t>(memoryBytes / sizeof(T), minRead * 4)), directory(directory), less(less) {}
+    ~ExternalSorter() {
+        for (auto &run: runs) unlink(run.c_str());
+    }
+    ExternalSorter(const ExternalSorter &) = delete;
+    ExternalSorter &operator=(const ExternalSorter &) = delete;
+
+    void add(const T &value) {
+        if (buffer.empty()) buffer.reserve(capacity); //no reallocation above the budget
+        buffer.push_back(value);
+        if (buffer.size() == capacity) spill();
+    }
+
+    size_t nRuns() const { return runs.size(); }
+
+    //out(const T &) gets all values in order, the sorter is empty afterwards
+    template<class Out>
+    void finish(Out &&out) {
+        if (runs.empty()) { //everything fitted
+            std::sort(buffer.begin(), buffer.end(), less);
+            for (auto &value: buffer) out(value);
+        } else {
+            spill();
+            std::vector<T>().swap(buffer); //the read buffers take its place
+            size_t fanIn = std::max<size_t>(2, capacity / minRead - 1);
+            while (runs.size() > fanIn) { //intermediate passes, each run gets at least minRead values
+                std::vector<std::string> merged;
+                for (size_t first = 0; first < runs.size(); first += fanIn) {
+                    std::vector<std::string> group(runs.begin() + first,
+                                                   runs.begin() + std::min(runs.size(), first + fanIn));
+                    merged.push_back(newRun());
+                    FILE *file = fopen(merged.back().c_str(), "wb");
+                    if (!file) {
+                        printf("Cannot write spill file %s\n", merged.back().c_str());
+                        exit(1);
+                    }
+                    std::vector<T> written;
+                    auto write = [&written, file, &merged]() {
+                        if (fwrite(written.data(), sizeof(T), written.size(), file) != written.size()) {
+                            printf("Cannot write spill file %s\n", merged.back().c_str());
+                            exit(1);
+                        }
+                        written.clear();
+                    };
+                    merge(group, [&](const T &value) {
+                        written.push_back(value);
+                        if (written.size() == minRead) write();
+                    });
+                    write();
+                    if (fclose(file) != 0) {
+                        printf("Cannot write spill file %s\n", merged.back().c_str());
+                        exit(1);
+                    }
+                }
+                runs.swap(merged);
+            }
+            merge(runs, out);
+            runs.clear();
+        }
+        buffer.clear();
+    }
+
+private:
+    static constexpr size_t minRead = 4096; //values read from a run at once
+
+    struct Reader {
+        FILE *file;
+        std::vector<T> values;
+        size_t next = 0;
+
+        bool fill(size_t n) {
+            values.resize(n);
+            values.resize(fread(values.data(), sizeof(T), n, file));
+            next = 0;
+            return !values.empty();
+        }
+    };
+
+    std::string newRun() {
+        std::string name = directory + "/pythiaSpillXXXXXX";
+        int fd = mkstemp(&name[0]);
+        if (fd < 0) {
+            printf("Cannot create a spill file in %s\n", directory.c_str());
+            exit(1);
+        }
+        close(fd);
+        return name;
+    }
+
+    void spill() {
+        if (buffer.empty()) return;
+        std::sort(buffer.begin(), buffer.end(), less);
+        runs.push_back(newRun());
+        FILE *file = fopen(runs.back().c_str(), "wb");
+        if (!file || fwrite(buffer.data(), sizeof(T), buffer.size(), file) != buffer.size()) {
+            printf("Cannot write spill file %s\n", runs.back().c_str());
+            exit(1);
+        }
+        if (fclose(file) != 0) {
+            printf("Cannot write spill file %s\n", runs.back().c_str());
+            exit(1);
+        }
+        buffer.clear();
+    }
+
+    //k-way merge with a heap of the next value of every run, the runs are removed afterwards
+    template<class Out>
+    void merge(const std::vector<std::string> &group, Out &&out) {
+        size_t readSize = std::max(minRead, capacity / (group.size() + 1));
+        std::vector<Reader> readers(group.size());
+        auto greater = [this, &readers](size_t a, size_t b) {
+            return less(readers[b].values[readers[b].next], readers[a].values[readers[a].next]);
+        };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+        for (size_t r = 0; r < group.size(); ++r) {
+            readers[r].file = fopen(group[r].c_str(), "rb");
+            if (!readers[r].file) { //its values would be missing from the output
+                printf("Cannot read spill file %s\n", group[r].c_str());
+                exit(1);
+            }
+            if (readers[r].fill(readSize)) heap.push(r);
+        }
+        while (!heap.empty()) {
+            size_t r = heap.top();
+            heap.pop();
+            auto &reader = readers[r];
+            out(reader.values[reader.next]);
+            if (++reader.next < reader.values.size() || reader.fill(readSize)) heap.push(r);
+        }
+        for (size_t r = 0; r < group.size(); ++r) {
+            fclose(readers[r].file);
+            unlink(group[r].c_str());
+        }
+    }
+
+    size_t capacity;
+    std::string directory;
+    Less less;
+    std::vector<T> buffer;
+    std::vector<std::string> runs;
+};
+
+#endif //PYTHIAPROJECT_EXTERNALSORT_H
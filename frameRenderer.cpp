@@ -0,0 +1,180 @@
+#include "frameRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "TColor.h"
+#include "TROOT.h"
+#include "TStyle.h"
+#include "TSystem.h"
+
+
+
+static TString hexColour(int col) {
+    auto colour = gROOT->GetColor(col);
+    return colour ? TString(colour->AsHexString()) : TString("#000000");
+}
+
+FrameRenderer::FrameRenderer(TCanvas *canvas, TH2D *frameHist, const TString &pattern)
+        : canvas(canvas), frameHist(frameHist), pattern(pattern) {
+    gSystem->mkdir(gSystem->GetDirName(pattern), true);
+}
+
+FrameRenderer::~FrameRenderer() {
+    delete image;
+    delete background;
+}
+
+//==========================================================================
+// Paints the canvas once and keeps the result together with everything
+// needed to paint on it later without ROOT: pixel mapping and palette.
+
+void FrameRenderer::captureStatic() {
+    canvas->Modified();
+    canvas->Update();
+
+    delete background;
+    background = TImage::Create();
+    background->FromPad(canvas);
+
+    auto xAxis = frameHist->GetXaxis(), yAxis = frameHist->GetYaxis();
+    double x1 = xAxis->GetXmin(), x2 = xAxis->GetXmax();
+    double y1 = yAxis->GetXmin(), y2 = yAxis->GetXmax();
+    xA = (canvas->XtoAbsPixel(x2) - canvas->XtoAbsPixel(x1)) / (x2 - x1);
+    xB = canvas->XtoAbsPixel(x1) - xA * x1;
+    yA = (canvas->YtoAbsPixel(y2) - canvas->YtoAbsPixel(y1)) / (y2 - y1);
+    yB = canvas->YtoAbsPixel(y1) - yA * y1;
+    cellW = std::max(1, int(std::ceil(std::abs(xA) * (x2 - x1) / xAxis->GetNbins())));
+    cellH = std::max(1, int(std::ceil(std::abs(yA) * (y2 - y1) / yAxis->GetNbins())));
+
+    logZ = canvas->GetLogz();
+    zMin = frameHist->GetMinimum();
+    zMax = frameHist->GetMaximum();
+    if (logZ) {
+        zMin = std::log10(zMin);
+        zMax = std::log10(zMax);
+    }
+
+    palette.clear();
+    for (int i = 0; i < gStyle->GetNumberOfColors(); ++i)
+        palette.push_back(hexColour(gStyle->GetColorPalette(i)));
+}
+
+void FrameRenderer::protectArea(double x1, double y1, double x2, double y2) {
+    int w = canvas->GetWw(), h = canvas->GetWh();
+    protectedAreas.insert(protectedAreas.end(), {int(x1 * w), int((1 - y2) * h),
+                                                 int((x2 - x1) * w), int((y2 - y1) * h)});
+}
+
+//==========================================================================
+// Frames.
+
+void FrameRenderer::beginFrame() {
+    delete image;
+    image = (TImage *) background->Clone("frame");
+}
+
+void FrameRenderer::drawCell(double y, double phi, double value) {
+    double z = logZ ? std::log10(value) : value;
+    if (!(value > 0 && z >= zMin) || palette.empty()) return;
+    double frac = std::min(1.0, (z - zMin) / (zMax - zMin));
+    auto &col = palette[int(frac * (palette.size() - 1) + 0.5)];
+    image->FillRectangle(col, xPixel(y) - cellW / 2, yPixel(phi) - cellH / 2, cellW, cellH);
+}
+
+void FrameRenderer::drawMarker(double y, double phi, int style, int col, double size) {
+    int x0 = xPixel(y), y0 = yPixel(phi);
+    int half = std::max(1, int(4 * size)); //ROOT marker of size 1 is 8 pixels wide
+    auto hex = hexColour(col);
+    if (style == 21) {
+        image->FillRectangle(hex, x0 - half, y0 - half, 2 * half, 2 * half);
+    } else {
+        image->DrawLine(x0 - half, y0 - half, x0 + half, y0 + half, hex);
+        image->DrawLine(x0 - half, y0 + half, x0 + half, y0 - half, hex);
+    }
+}
+
+void FrameRenderer::drawParticle(const Pythia8::Particle &p) {
+    int colPos = kRed, colNeg = kBlue, colNeut = kGreen + 3; //same as drawParticles_histogram
+    if (p.charge() > 0) {
+        drawMarker(p.y(), p.phi(), 5, colPos, 0.8);
+    } else if (p.charge() < 0) {
+        drawMarker(p.y(), p.phi(), 5, colNeg, 0.8);
+    } else {
+        drawMarker(p.y(), p.phi(), 21, colNeut, 0.4);
+        drawMarker(p.y(), p.phi(), 5, colNeut, 0.8);
+    }
+}
+
+void FrameRenderer::drawLabel(double x, double y, const TString &txt) {
+    int w = canvas->GetWw(), h = canvas->GetWh();
+    image->DrawText(int(x * w), int((1 - y) * h), txt, int(0.032 * h), "#000000");
+}
+
+void FrameRenderer::endFrame() {
+    for (size_t i = 0; i + 3 < protectedAreas.size(); i += 4)
+        background->CopyArea(image, protectedAreas[i], protectedAreas[i + 1], protectedAreas[i + 2],
+                             protectedAreas[i + 3], protectedAreas[i], protectedAreas[i + 1]);
+    image->WriteImage(Form(pattern.Data(), iFrame));
+    ++iFrame;
+}
+
+//==========================================================================
+// One frame of an event: jet areas as in the pT flow histogram, then particles.
+
+void renderEventFrame(FrameRenderer &frames, const std::vector<fastjet::PseudoJet> &jets,
+                      const std::vector<Pythia8::Particle> &particles, double minpT, const TString &label) {
+    frames.beginFrame();
+    for (auto &jet: jets) {
+        for (auto &c: jet.constituents()) {
+            if (c.pt() > 1e-50) continue; //ghosts only, as for the pT flow
+            frames.drawCell(c.rap(), c.phi_std(), jet.pt());
+        }
+    }
+    for (auto &p: particles) {
+        if (p.pT() > minpT) frames.drawParticle(p);
+    }
+    frames.drawLabel(0.07, 0.90, label);
+    frames.endFrame();
+}
+
+//==========================================================================
+// Steps through the merging of one jet. In every frame each subjet which
+// exists at that step is painted with its own pT.
+
+void renderClusteringHistory(FrameRenderer &frames, const fastjet::ClusterSequence &clustSeq,
+                             const fastjet::PseudoJet &jet, int nStepsMax) {
+    auto &history = clustSeq.history();
+    auto &pseudoJets = clustSeq.jets();
+
+    std::vector<int> nodes, merges, todo = {jet.cluster_hist_index()};
+    while (!todo.empty()) {
+        int h = todo.back();
+        todo.pop_back();
+        nodes.push_back(h);
+        if (history[h].parent1 < 0) continue; //an original particle
+        merges.push_back(h);
+        todo.push_back(history[h].parent1);
+        if (history[h].parent2 >= 0) todo.push_back(history[h].parent2);
+    }
+    std::sort(merges.begin(), merges.end());
+    if (merges.empty()) return;
+
+    int nSteps = std::min<int>(nStepsMax, merges.size());
+    for (int iStep = 1; iStep <= nSteps; ++iStep) {
+        int last = merges[(long) iStep * merges.size() / nSteps - 1];
+        frames.beginFrame();
+        for (int h: nodes) {
+            bool exists = history[h].parent1 < 0 || h <= last;
+            bool mergedAway = h != jet.cluster_hist_index() && history[h].child <= last;
+            if (!exists || mergedAway) continue;
+            auto &subjet = pseudoJets[history[h].jetp_index];
+            for (auto &c: clustSeq.constituents(subjet)) {
+                if (c.pt() > 1e-50) frames.drawMarker(c.rap(), c.phi_std(), 5, kBlack, 0.8);
+                else frames.drawCell(c.rap(), c.phi_std(), subjet.pt());
+            }
+        }
+        frames.drawLabel(0.07, 0.90, Form("Clustering step %d / %d", iStep, nSteps));
+        frames.endFrame();
+    }
+}
@@ -0,0 +1,63 @@
+//
+// Numbered image sequences (frame_00000.png, frame_00001.png, ...) for animations.
+//
+
+#ifndef PYTHIAPROJECT_FRAMERENDERER_H
+#define PYTHIAPROJECT_FRAMERENDERER_H
+
+#include <vector>
+
+#include "Pythia8/Pythia.h"
+#include "TCanvas.h"
+#include "TString.h"
+#include "TH2D.h"
+#include "TImage.h"
+#include "fastjet/PseudoJet.hh"
+#include "fastjet/ClusterSequence.hh"
+
+
+
+// ROOT paints the static layer (axes, palette, legend, titles) only once and it is kept as an image.
+// Every frame starts from a copy of that image and only the jet cells and particles are painted on it,
+// so no canvas is repainted per frame.
+class FrameRenderer {
+public:
+    FrameRenderer(TCanvas *canvas, TH2D *frameHist, const TString &pattern);
+    ~FrameRenderer();
+
+    void captureStatic(); //call once everything static is drawn on the canvas
+    void protectArea(double x1, double y1, double x2, double y2); //NDC, restored from the static layer (legend)
+
+    void beginFrame();
+    void drawCell(double y, double phi, double value); //one bin of frameHist coloured as the palette
+    void drawMarker(double y, double phi, int style, int col, double size = 1.0); //styles 5 and 21 only
+    void drawParticle(const Pythia8::Particle &p);
+    void drawLabel(double x, double y, const TString &txt); //NDC
+    void endFrame();
+
+    int nFrames() const { return iFrame; }
+
+private:
+    int xPixel(double y) const { return int(xA * y + xB); }
+    int yPixel(double phi) const { return int(yA * phi + yB); }
+
+    TCanvas *canvas;
+    TH2D *frameHist;
+    TString pattern;
+    TImage *background = nullptr, *image = nullptr;
+    int iFrame = 0;
+
+    double xA = 0, xB = 0, yA = 0, yB = 0; //pad coordinates -> pixels, frozen at capture
+    int cellW = 1, cellH = 1;
+    double zMin = 1, zMax = 1;
+    bool logZ = false;
+    std::vector<TString> palette; //hex colours
+    std::vector<int> protectedAreas; //x, y, w, h in pixels
+};
+
+void renderEventFrame(FrameRenderer &frames, const std::vector<fastjet::PseudoJet> &jets,
+                      const std::vector<Pythia8::Particle> &particles, double minpT, const TString &label);
+void renderClusteringHistory(FrameRenderer &frames, const fastjet::ClusterSequence &clustSeq,
+                             const fastjet::PseudoJet &jet, int nStepsMax);
+
+#endif //PYTHIAPROJECT_FRAMERENDERER_H
@@ -0,0 +1,25 @@
+#include "graphicsPool.h"
+
+#include <map>
+
+
+
+static std::map<TVirtualPad *, GraphicsPool> pools;
+
+GraphicsPool &graphicsPool(TVirtualPad *pad) {
+    return pools[pad];
+}
+
+//==========================================================================
+// Pooled objects are drawn without kCanDelete, so clearing the pad only
+// takes them off its list of primitives and they can be drawn again.
+
+void newPage(TVirtualPad *pad) {
+    pad->Clear();
+    graphicsPool(pad).reset();
+}
+
+void releaseGraphicsPool(TVirtualPad *pad) {
+    pad->Clear();
+    pools.erase(pad);
+}
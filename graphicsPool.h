@@ -0,0 +1,48 @@
+//
+// Markers, texts and boxes drawn by drawF.cpp are taken from a pool of their canvas instead of
+// being allocated per draw, and the pool is given back when a new page starts.
+//
+
+#ifndef PYTHIAPROJECT_GRAPHICSPOOL_H
+#define PYTHIAPROJECT_GRAPHICSPOOL_H
+
+#include <memory>
+#include <vector>
+
+#include "TVirtualPad.h"
+#include "TMarker.h"
+#include "TLatex.h"
+#include "TPave.h"
+
+
+
+class GraphicsPool {
+public:
+    //the object is free again after the next reset(), all its attributes have to be set by the caller
+    TMarker *marker() { return markers.next(); }
+    TLatex *text() { return texts.next(); }
+    TPave *box() { return boxes.next(); }
+    void reset() { markers.used = texts.used = boxes.used = 0; }
+
+private:
+    template<class T>
+    struct Slots {
+        std::vector<std::unique_ptr<T>> objects;
+        size_t used = 0;
+
+        T *next() {
+            if (used == objects.size()) objects.emplace_back(new T());
+            return objects[used++].get();
+        }
+    };
+
+    Slots<TMarker> markers;
+    Slots<TLatex> texts;
+    Slots<TPave> boxes;
+};
+
+GraphicsPool &graphicsPool(TVirtualPad *pad = gPad);
+void newPage(TVirtualPad *pad = gPad); //clears the pad and gives its pooled objects back
+void releaseGraphicsPool(TVirtualPad *pad); //before the canvas is deleted
+
+#endif //PYTHIAPROJECT_GRAPHICSPOOL_H
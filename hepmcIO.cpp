@@ -0,0 +1,45 @@
+#include "hepmcIO.h"
+
+#include "HepMC3/GenEvent.h"
+#include "HepMC3/ReaderAscii.h"
+
+
+
+HepMCReader::HepMCReader(const std::string &file, int queueSize, Pythia8::ParticleData &particleData)
+        : queue(queueSize), particleData(particleData), parser(&HepMCReader::parse, this, file) {}
+
+HepMCReader::~HepMCReader() {
+    queue.close(); //a parser waiting for space gives up
+    parser.join();
+}
+
+bool HepMCReader::next(FinalState &finalState) {
+    if (!queue.pop(finalState)) return false;
+    ++nEvents;
+    return true;
+}
+
+//==========================================================================
+// Parser thread.
+
+void HepMCReader::parse(std::string file) {
+    HepMC3::ReaderAscii reader(file);
+    HepMC3::GenEvent event;
+    FinalState finalState;
+    while (!reader.failed()) {
+        if (!reader.read_event(event) || reader.failed()) break;
+        event.set_units(HepMC3::Units::GEV, HepMC3::Units::MM);
+
+        finalState.clear();
+        finalState.number = event.event_number();
+        finalState.weight = event.weights().empty() ? 1. : event.weights()[0];
+        for (auto &p: event.particles()) {
+            if (p->status() != 1) continue;
+            auto &m = p->momentum();
+            finalState.add(m.px(), m.py(), m.pz(), m.e(), p->pid(), particleData.chargeType(p->pid()), 1);
+        }
+        if (!queue.push(finalState)) break;
+    }
+    reader.close();
+    queue.close();
+}
@@ -0,0 +1,38 @@
+//
+// HepMC3 ASCII files: external samples as input instead of pythia.next(), and generated events as output.
+//
+
+#ifndef PYTHIAPROJECT_HEPMCIO_H
+#define PYTHIAPROJECT_HEPMCIO_H
+
+#include <string>
+#include <thread>
+
+#include "Pythia8/Pythia.h"
+
+#include "boundedQueue.h"
+#include "eventReplay.h"
+
+
+
+// The file is parsed in its own thread, which keeps up to queueSize final states ready.
+// Only final particles (status 1) are kept, momenta in GeV.
+class HepMCReader {
+public:
+    HepMCReader(const std::string &file, int queueSize, Pythia8::ParticleData &particleData);
+    ~HepMCReader();
+
+    bool next(FinalState &finalState); //false at the end of the file
+    long nRead() const { return nEvents; }
+    size_t queued() { return queue.size(); } //final states parsed ahead
+
+private:
+    void parse(std::string file);
+
+    BoundedQueue<FinalState> queue;
+    Pythia8::ParticleData &particleData; //only read, for the charges
+    std::thread parser;
+    long nEvents = 0;
+};
+
+#endif //PYTHIAPROJECT_HEPMCIO_H
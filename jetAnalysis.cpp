@@ -0,0 +1,242 @@
+//
+// Post-processing of a jet tree (see Tree:file) with ROOT::RDataFrame on all cores.
+//
+//   jetAnalysis <tree file> [--threads n] [--out dir] [--config ../config1.cmnd]
+//
+// e.g. "jetAnalysis ../results/jets.root --out ../results/analysis" writes, for every jet definition
+// of the tree, the jet spectra (as main.cpp draws them), jets per event, the leading jet pT, the pT
+// ratio to the first definition and the jet image, plus the particle image and multiplicity. All of
+// them are booked first and filled in one event loop. --threads 0 (default) uses every core.
+// --config reads the .cmnd file of the run, so the images are binned as there (Display:*).
+// Built from jetAnalysis.cpp, spectra.cpp, drawF.cpp, graphicsPool.cpp, binning.cpp and userSettings.cpp
+// with the same flags as main.cpp, linked with -lROOTDataFrame.
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Pythia8/Pythia.h"
+#include "ROOT/RDataFrame.hxx"
+#include "ROOT/RVec.hxx"
+#include "TCanvas.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TString.h"
+#include "TSystem.h"
+
+#include "drawF.h"
+#include "graphicsPool.h"
+#include "spectra.h"
+#include "userSettings.h"
+
+
+
+using ROOT::RVecD;
+using ROOT::RVecF;
+
+// Results of one jet definition, booked before the event loop runs.
+struct DefinitionResults {
+    std::string name; //branch prefix, e.g. antikt_R03
+    TString title;
+    ROOT::RDF::RResultPtr<TH1D> pT, mass, constituents, nJets, leadingPt;
+    ROOT::RDF::RResultPtr<TH2D> image;
+};
+
+// antikt_R03 -> "Anti-#it{k_{t}} jets, #it{R} = 0.3", inverse of jetBranchName
+static TString jetTitle(const std::string &name) {
+    size_t at = name.rfind("_R");
+    std::string algorithm = name.substr(0, at);
+    std::string title = algorithm == "antikt" ? "Anti-#it{k_{t}} jets" : algorithm == "kt" ? "#it{k_{t}} jets"
+                      : algorithm == "ca" ? "Cambridge-Aachen jets" : algorithm;
+    if (at != std::string::npos) title += Form(", #it{R} = %.1f", atoi(name.c_str() + at + 2) / 10.);
+    return title;
+}
+
+static ROOT::RDF::TH1DModel model(const std::string &name, const FastAxis &axis) {
+    return ROOT::RDF::TH1DModel(name.c_str(), "", axis.n(), axis.edges().data());
+}
+
+static void copyBins(const TH1D &h, Spectrum &spectrum) {
+    for (int i = 0; i <= spectrum.axis.n() + 1; ++i) {
+        spectrum.sumW[i] = h.GetBinContent(i);
+        spectrum.sumW2[i] = h.GetBinError(i) * h.GetBinError(i);
+    }
+    spectrum.entries = h.GetEntries();
+}
+
+//==========================================================================
+// Pages in the style of drawJetSpectra, one pdf for all of them.
+
+static void drawPages(TCanvas *canvas, const std::vector<TH1D *> &pages, const std::vector<bool> &logX,
+                      const TString &description, const TString &label, const TString &fileName) {
+    canvas->cd();
+    for (size_t i = 0; i < pages.size(); ++i) {
+        newPage(canvas);
+        canvas->SetLogx(logX[i]);
+        canvas->SetLogy(pages[i]->GetMaximum() > 0);
+        pages[i]->SetLineColor(kBlue);
+        pages[i]->Draw("hist e");
+        drawText(0.06, 0.96, description);
+        drawText(0.98, 0.96, label, 31);
+        canvas->Print(fileName + (pages.size() == 1 ? "" : i == 0 ? "(" : i + 1 == pages.size() ? ")" : ""));
+    }
+    canvas->SetLogx(0);
+    canvas->SetLogy(0);
+}
+
+static void drawImage(TCanvas *canvas, TH2D *image, const TString &description, const TString &label,
+                      const TString &fileName) {
+    canvas->cd();
+    newPage(canvas);
+    canvas->SetLogz();
+    image->GetZaxis()->SetMoreLogLabels();
+    image->Draw("colz");
+    drawText(0.06, 0.96, description);
+    drawText(0.87, 0.96, label, 31);
+    canvas->Print(fileName);
+    canvas->SetLogz(0);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <tree file> [--threads n] [--out dir] [--config file]\n", argv[0]);
+        return 1;
+    }
+
+    int nThreads = 0;
+    TString out = "../results/analysis", config;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--threads")) nThreads = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "--out")) out = argv[i + 1];
+        else if (!strcmp(argv[i], "--config")) config = argv[i + 1]; //for Display:* of the run
+    }
+
+    //binning of the images as in main.cpp
+    Pythia8::Pythia pythia("../share/Pythia8/xmldoc", false);
+    addUserSettings(pythia.settings);
+    if (!config.IsNull()) pythia.readFile(config.Data());
+    Binning binning(pythia.settings);
+
+    ROOT::EnableImplicitMT(nThreads);
+    TH1::SetDefaultSumw2(); //all fills are weighted
+    ROOT::RDataFrame frame("events", argv[1]);
+    ROOT::RDF::RNode node = frame;
+
+    //jet definitions of the tree, from the <def>_constituents branches
+    std::vector<DefinitionResults> definitions;
+    const std::string suffix = "_constituents";
+    for (auto &column: frame.GetColumnNames()) {
+        if (column.size() <= suffix.size() || column.compare(column.size() - suffix.size(), suffix.size(), suffix) != 0)
+            continue;
+        definitions.emplace_back();
+        definitions.back().name = column.substr(0, column.size() - suffix.size());
+        definitions.back().title = jetTitle(definitions.back().name);
+    }
+    if (definitions.empty()) {
+        printf("%s has no jets, is it a Tree:file of main?\n", argv[1]);
+        return 1;
+    }
+
+    //booking, nothing is read until the first result is asked for
+    JetSpectra axes; //binning of the spectra of main.cpp
+    auto jetCount = FastAxis::uniform(30, -0.5, 29.5);
+    auto imageModel = createTH2D(binning);
+    auto weights = [](const RVecF &values, double weight) { return RVecD(values.size(), weight); };
+    auto pTweights = [](const RVecF &pT, double weight) {
+        RVecD result(pT.size());
+        for (size_t i = 0; i < pT.size(); ++i) result[i] = pT[i] * weight;
+        return result;
+    };
+    for (auto &d: definitions) {
+        const std::string &n = d.name;
+        node = node.Define(n + "_w", weights, {n + "_pt", "weight"})
+                   .Define(n + "_ptw", pTweights, {n + "_pt", "weight"})
+                   .Define(n + "_nJets", [](const RVecF &pT) { return int(pT.size()); }, {n + "_pt"})
+                   .Define(n + "_leadingPt", [](const RVecF &pT) { return pT.empty() ? 0.f : pT[0]; }, {n + "_pt"});
+        d.pT = node.Histo1D(model(n + "_pT", axes.pT.axis), n + "_pt", n + "_w");
+        d.mass = node.Histo1D(model(n + "_mass", axes.mass.axis), n + "_m", n + "_w");
+        d.constituents = node.Histo1D(model(n + "_constituents", axes.multiplicity.axis), n + "_n", n + "_w");
+        d.nJets = node.Histo1D(model(n + "_nJets", jetCount), n + "_nJets", "weight");
+        d.leadingPt = node.Histo1D(model(n + "_leadingPt", axes.pT.axis), n + "_leadingPt", "weight");
+        TH2D image(*imageModel);
+        image.SetName((n + "_image").c_str());
+        d.image = node.Histo2D(ROOT::RDF::TH2DModel(image), n + "_y", n + "_phi", n + "_ptw");
+    }
+    node = node.Define("particle_y", [](const RVecF &pz, const RVecF &e) {
+                           RVecF y(pz.size());
+                           for (size_t i = 0; i < pz.size(); ++i)
+                               y[i] = 0.5f * std::log((e[i] + pz[i]) / (e[i] - pz[i]));
+                           return y;
+                       }, {"pz", "e"})
+               .Define("particle_phi", [](const RVecF &px, const RVecF &py) {
+                           RVecF phi(px.size());
+                           for (size_t i = 0; i < px.size(); ++i) phi[i] = std::atan2(py[i], px[i]);
+                           return phi;
+                       }, {"px", "py"})
+               .Define("particle_pT", [](const RVecF &px, const RVecF &py) {
+                           RVecF pT(px.size());
+                           for (size_t i = 0; i < px.size(); ++i) pT[i] = std::hypot(px[i], py[i]);
+                           return pT;
+                       }, {"px", "py"})
+               .Define("particle_ptw", pTweights, {"particle_pT", "weight"})
+               .Define("nParticles", [](const RVecF &px) { return int(px.size()); }, {"px"});
+    TH2D particleModel(*imageModel);
+    particleModel.SetName("particle_image");
+    particleModel.GetZaxis()->SetTitle("Particle #it{p}_{T} [GeV]");
+    auto particleImage = node.Histo2D(ROOT::RDF::TH2DModel(particleModel), "particle_y", "particle_phi",
+                                      "particle_ptw");
+    auto nParticles = node.Histo1D(model("nParticles", FastAxis::uniform(100, 0, 2000)), "nParticles", "weight");
+    auto count = node.Count();
+    delete imageModel;
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned long long nEvents = *count; //runs the event loop, every booked result is filled
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Processed %llu events of %s in %.2f s on %u threads\n\n", nEvents, argv[1], seconds,
+           ROOT::GetThreadPoolSize());
+
+    //drawing, as main.cpp does
+    gSystem->mkdir(out, true);
+    setUpRootStyle();
+    auto canvas = new TCanvas();
+    canvas->SetMargin(0.1, 0.04, 0.1, 0.06);
+    TString description = Form("Number of events: %llu", nEvents);
+    TString prefix = out + "/[" + description + "] ";
+    auto &reference = definitions.front();
+    for (auto &d: definitions) {
+        JetSpectra spectra;
+        copyBins(*d.pT, spectra.pT);
+        copyBins(*d.mass, spectra.mass);
+        copyBins(*d.constituents, spectra.multiplicity);
+        drawJetSpectra(canvas, spectra, description, d.title, prefix + d.title + " spectra.pdf");
+
+        d.nJets->SetTitle(";Jets per event;Events");
+        d.leadingPt->SetTitle(";Leading jet #it{p}_{T} [GeV];Events");
+        std::vector<TH1D *> pages = {d.nJets.GetPtr(), d.leadingPt.GetPtr()};
+        TH1D ratio(*d.pT); //to the first definition
+        if (&d != &reference) {
+            ratio.Divide(reference.pT.GetPtr());
+            ratio.SetTitle(Form(";Jet #it{p}_{T} [GeV];Jets / %s jets", reference.name.c_str()));
+            pages.push_back(&ratio);
+        }
+        drawPages(canvas, pages, {false, true, true}, description, d.title, prefix + d.title + " per event.pdf");
+    }
+    nParticles->SetTitle(";Particles per event;Events");
+    drawPages(canvas, {nParticles.GetPtr()}, {false}, description, "Final-state particles",
+              prefix + "particles per event.pdf");
+
+    canvas->SetMargin(0.06, 0.14, 0.08, 0.06); //as the jet pages of main.cpp
+    for (auto &d: definitions)
+        drawImage(canvas, d.image.GetPtr(), description, d.title, prefix + d.title + " image.pdf");
+    drawImage(canvas, particleImage.GetPtr(), description, "Final-state particles", prefix + "particles image.pdf");
+    printf("Produced %s\n\n", out.Data());
+
+    releaseGraphicsPool(canvas);
+    delete canvas;
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "jetCatalog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+static const char catalogMagic[8] = {'P', 'P', 'J', 'E', 'T', 'C', 'A', 'T'};
+
+JetCatalogWriter::JetCatalogWriter(const std::string &catalog, const std::vector<std::string> &definitions,
+                                   const WriterOptions &options, size_t memoryBudget,
+                                   const std::string &spillDirectory)
+        : catalog(catalog), jets(catalog + ".jets", options), byPt(memoryBudget / 2, spillDirectory),
+          byEvent(memoryBudget / 2, spillDirectory), nDefinitions(definitions.size()) {
+    if (!jets.good()) {
+        printf("Cannot open jet catalog %s\n", catalog.c_str());
+        return;
+    }
+    CatalogHeader header{};
+    jets.write(&header, sizeof(header)); //rewritten by close()
+    std::ofstream defs(catalog + ".defs");
+    for (auto &name: definitions) defs << name << "\n";
+}
+
+void JetCatalogWriter::add(const JetRecord &record) {
+    jets.write(&record, sizeof(record)); //copied into the chunk being filled
+    JetIndexKey key{record.event, record.definition, 0, record.pt, uint32_t(nJets)};
+    byPt.add(key);
+    byEvent.add(key);
+    ++nJets;
+}
+
+//==========================================================================
+// The indexes are sorted from the keys alone, spilled runs are merged straight into the index files.
+
+template<class Sorter>
+static void writeIndex(const std::string &file, Sorter &sorter) {
+    FILE *out = fopen(file.c_str(), "wb");
+    if (!out) {
+        printf("Cannot write %s\n", file.c_str());
+        return;
+    }
+    std::vector<uint32_t> records;
+    records.reserve(1 << 16);
+    auto flush = [&records, out]() {
+        fwrite(records.data(), sizeof(uint32_t), records.size(), out);
+        records.clear();
+    };
+    sorter.finish([&](const JetIndexKey &key) {
+        records.push_back(key.record);
+        if (records.size() == records.capacity()) flush();
+    });
+    flush();
+    fclose(out);
+}
+
+void JetCatalogWriter::close() {
+    if (!jets.good()) return;
+    CatalogHeader header{};
+    memcpy(header.magic, catalogMagic, 8);
+    header.nJets = nJets;
+    header.recordSize = sizeof(JetRecord);
+    header.nDefinitions = nDefinitions;
+    jets.writeAt(&header, sizeof(header), 0);
+    jets.close();
+
+    if (byPt.nRuns() > 0) printf("Merging %zu spilled runs per jet catalog index\n", byPt.nRuns() + 1);
+    writeIndex(catalog + ".byPt", byPt);
+    writeIndex(catalog + ".byEvent", byEvent);
+}
+
+//==========================================================================
+// Reader.
+
+const void *JetCatalog::map(const std::string &file, size_t &length) {
+    int fd = open(file.c_str(), O_RDONLY);
+    struct stat info{};
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0) {
+        if (fd >= 0) ::close(fd);
+        return nullptr;
+    }
+    length = info.st_size;
+    void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    return mapped == MAP_FAILED ? nullptr : mapped;
+}
+
+JetCatalog::JetCatalog(const std::string &catalog) {
+    jetsMap = map(catalog + ".jets", jetsLength);
+    byPt = (const uint32_t *) map(catalog + ".byPt", byPtLength);
+    byEvent = (const uint32_t *) map(catalog + ".byEvent", byEventLength);
+    std::ifstream defs(catalog + ".defs");
+    for (std::string name; std::getline(defs, name);) names.push_back(name);
+
+    CatalogHeader header{};
+    if (jetsMap && jetsLength >= sizeof(header)) memcpy(&header, jetsMap, sizeof(header));
+    uint64_t n = header.nJets;
+    bool indexed = n == 0 || (byPt && byPtLength == n * sizeof(uint32_t) &&
+                              byEvent && byEventLength == n * sizeof(uint32_t));
+    if (!jetsMap || memcmp(header.magic, catalogMagic, 8) != 0 || header.recordSize != sizeof(JetRecord) ||
+        jetsLength != sizeof(header) + n * sizeof(JetRecord) || !indexed) {
+        printf("%s is not a complete jet catalog\n", catalog.c_str());
+        return;
+    }
+    nJets = n;
+    records = (const JetRecord *) ((const char *) jetsMap + sizeof(header));
+}
+
+JetCatalog::~JetCatalog() {
+    if (jetsMap) munmap((void *) jetsMap, jetsLength);
+    if (byPt) munmap((void *) byPt, byPtLength);
+    if (byEvent) munmap((void *) byEvent, byEventLength);
+}
+
+int JetCatalog::definition(const std::string &name) const {
+    auto it = std::find(names.begin(), names.end(), name);
+    return it == names.end() ? -1 : int(it - names.begin());
+}
+
+JetCatalog::Range JetCatalog::selectPt(int definition, float pTmin, float pTmax) const {
+    auto below = [this](uint32_t i, std::pair<int, float> key) {
+        auto &r = records[i];
+        return r.definition != key.first ? r.definition < key.first : r.pt < key.second;
+    };
+    auto begin = std::lower_bound(byPt, byPt + nJets, std::make_pair(definition, pTmin), below);
+    auto end = std::lower_bound(begin, byPt + nJets, std::make_pair(definition, pTmax), below);
+    return {begin, end};
+}
+
+JetCatalog::Range JetCatalog::selectEvents(uint32_t first, uint32_t last) const {
+    auto begin = std::lower_bound(byEvent, byEvent + nJets, first,
+                                  [this](uint32_t i, uint32_t event) { return records[i].event < event; });
+    auto end = std::upper_bound(begin, byEvent + nJets, last,
+                                [this](uint32_t event, uint32_t i) { return event < records[i].event; });
+    return {begin, end};
+}
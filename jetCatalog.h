@@ -0,0 +1,120 @@
+//
+// Jet catalog of a run: one fixed-width record per jet with sorted indexes, read through mmap.
+// Only the standard library and POSIX are used, so the query tool (jetQuery.cpp) needs neither ROOT
+// nor FastJet.
+//
+
+#ifndef PYTHIAPROJECT_JETCATALOG_H
+#define PYTHIAPROJECT_JETCATALOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "asyncWriter.h"
+#include "externalSort.h"
+
+
+
+// <catalog>.jets     CatalogHeader, then JetRecords in the order they were added
+// <catalog>.byPt     uint32 record numbers sorted by (definition, pT)
+// <catalog>.byEvent  uint32 record numbers sorted by (event, definition, pT descending)
+// <catalog>.defs     one jet definition name per line, line number = JetRecord::definition
+struct JetRecord {
+    float pt, y, phi, mass, area; //area 0 unless Catalog:area
+    uint32_t event;
+    uint16_t definition;
+    uint16_t flags;
+    uint32_t rank; //0 for the leading jet of its event and definition
+};
+static_assert(sizeof(JetRecord) == 32, "JetRecord is written as it is");
+
+enum JetFlags : uint16_t {
+    kLeadingJet = 1,
+    kFiducial = 2, //|y| < rapidity range - R, the jet cannot stick out of the acceptance
+};
+
+struct CatalogHeader {
+    char magic[8]; //"PPJETCAT"
+    uint64_t nJets;
+    uint32_t recordSize, nDefinitions;
+    uint64_t reserved;
+};
+
+// What the indexes are sorted by, collected while the records are added.
+struct JetIndexKey {
+    uint32_t event;
+    uint16_t definition, pad;
+    float pt;
+    uint32_t record;
+};
+
+struct LessPt {
+    bool operator()(const JetIndexKey &a, const JetIndexKey &b) const {
+        return a.definition != b.definition ? a.definition < b.definition : a.pt < b.pt;
+    }
+};
+
+struct LessEvent {
+    bool operator()(const JetIndexKey &a, const JetIndexKey &b) const {
+        if (a.event != b.event) return a.event < b.event;
+        return a.definition != b.definition ? a.definition < b.definition : a.pt > b.pt;
+    }
+};
+
+// The index keys are sorted within memoryBudget bytes, above it through files in spillDirectory.
+class JetCatalogWriter {
+public:
+    JetCatalogWriter(const std::string &catalog, const std::vector<std::string> &definitions,
+                     const WriterOptions &options = WriterOptions(), size_t memoryBudget = size_t(1) << 30,
+                     const std::string &spillDirectory = "/tmp");
+    ~JetCatalogWriter() { close(); }
+
+    void add(const JetRecord &record);
+    void close(); //writes the header and builds the indexes
+    uint64_t size() const { return nJets; }
+    uint64_t bytes() const { return jets.size(); } //of the jet records, the indexes come at close
+
+private:
+    std::string catalog;
+    AsyncWriter jets;
+    ExternalSorter<JetIndexKey, LessPt> byPt;
+    ExternalSorter<JetIndexKey, LessEvent> byEvent;
+    uint64_t nJets = 0;
+    uint32_t nDefinitions;
+};
+
+class JetCatalog {
+public:
+    explicit JetCatalog(const std::string &catalog);
+    ~JetCatalog();
+    JetCatalog(const JetCatalog &) = delete;
+    JetCatalog &operator=(const JetCatalog &) = delete;
+
+    bool good() const { return records != nullptr; }
+    uint64_t size() const { return nJets; }
+    const JetRecord &operator[](uint32_t i) const { return records[i]; }
+    const std::vector<std::string> &definitions() const { return names; }
+    int definition(const std::string &name) const; //-1 if unknown
+
+    //record numbers of the selected jets, a contiguous piece of an index
+    struct Range {
+        const uint32_t *begin, *end;
+        size_t size() const { return end - begin; }
+    };
+    Range selectPt(int definition, float pTmin, float pTmax) const; //pTmin <= pT < pTmax
+    Range selectEvents(uint32_t first, uint32_t last) const;        //first <= event <= last
+
+private:
+    static const void *map(const std::string &file, size_t &length);
+
+    const JetRecord *records = nullptr;
+    const uint32_t *byPt = nullptr, *byEvent = nullptr;
+    const void *jetsMap = nullptr;
+    size_t jetsLength = 0, byPtLength = 0, byEventLength = 0;
+    uint64_t nJets = 0;
+    std::vector<std::string> names;
+};
+
+#endif //PYTHIAPROJECT_JETCATALOG_H
@@ -0,0 +1,77 @@
+//
+// Range selections on a jet catalog (see Catalog:file), without ROOT.
+//
+//   jetQuery <catalog> [--def antikt_R03] [--pt min:max] [--events first:last] [--y min:max]
+//                      [--flags mask] [--print n]
+//
+// e.g. "jetQuery ../results/run --def antikt_R03 --pt 30:40" counts anti-kt R = 0.3 jets with
+// 30 <= pT < 40 GeV. The pT or event range is looked up in the sorted indexes, the other cuts are
+// applied to the selected records only. Built from jetQuery.cpp, jetCatalog.cpp and asyncWriter.cpp.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "jetCatalog.h"
+
+
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <catalog> [--def name] [--pt min:max] [--events first:last] [--y min:max] "
+               "[--flags mask] [--print n]\n", argv[0]);
+        return 1;
+    }
+
+    std::string def;
+    double pTmin = 0, pTmax = 1e30, yMin = -1e30, yMax = 1e30;
+    long first = -1, last = -1;
+    unsigned flags = 0;
+    int nPrint = 10;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--def")) def = argv[i + 1];
+        else if (!strcmp(argv[i], "--pt")) sscanf(argv[i + 1], "%lf:%lf", &pTmin, &pTmax);
+        else if (!strcmp(argv[i], "--events")) sscanf(argv[i + 1], "%ld:%ld", &first, &last);
+        else if (!strcmp(argv[i], "--y")) sscanf(argv[i + 1], "%lf:%lf", &yMin, &yMax);
+        else if (!strcmp(argv[i], "--flags")) flags = strtoul(argv[i + 1], nullptr, 0);
+        else if (!strcmp(argv[i], "--print")) nPrint = atoi(argv[i + 1]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    JetCatalog catalog(argv[1]);
+    if (!catalog.good()) return 1;
+    int definition = def.empty() ? -1 : catalog.definition(def);
+    if (!def.empty() && definition < 0) {
+        printf("Unknown jet definition %s, the catalog has:", def.c_str());
+        for (auto &name: catalog.definitions()) printf(" %s", name.c_str());
+        printf("\n");
+        return 1;
+    }
+
+    //the narrowest indexed range first
+    JetCatalog::Range range;
+    bool byEvent = first >= 0 && (definition < 0 || last - first < 1000);
+    if (byEvent) range = catalog.selectEvents(first, last < 0 ? first : last);
+    else if (definition >= 0) range = catalog.selectPt(definition, pTmin, pTmax);
+    else range = catalog.selectEvents(0, UINT32_MAX);
+
+    long nSelected = 0;
+    for (auto it = range.begin; it != range.end; ++it) {
+        auto &jet = catalog[*it];
+        if (definition >= 0 && jet.definition != definition) continue;
+        if (jet.pt < pTmin || jet.pt >= pTmax || jet.y < yMin || jet.y >= yMax) continue;
+        if (first >= 0 && (jet.event < first || jet.event > (last < 0 ? first : last))) continue;
+        if ((jet.flags & flags) != flags) continue;
+        if (nSelected++ < nPrint)
+            printf("  event %9u  %-12s pT = %8.3f  y = %6.3f  phi = %6.3f  m = %7.3f  area = %5.3f  rank %u\n",
+                   jet.event, catalog.definitions()[jet.definition].c_str(), jet.pt, jet.y, jet.phi, jet.mass,
+                   jet.area, jet.rank);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("%ld of %llu jets selected in %.2f ms\n", nSelected, (unsigned long long) catalog.size(), ms);
+
+    return 0;
+}
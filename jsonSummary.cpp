@@ -0,0 +1,68 @@
+#include "jsonSummary.h"
+
+#include <cmath>
+#include <cstdio>
+
+
+
+JsonSummaryWriter::JsonSummaryWriter(const std::string &file, const std::vector<std::string> &definitions,
+                                     const WriterOptions &options)
+        : out(file, options) {
+    if (!out.good()) printf("Cannot open event summaries %s\n", file.c_str());
+    for (size_t d = 0; d < definitions.size(); ++d) {
+        std::string key = d == 0 ? "\"" : ",\""; //names as made by jetBranchName, nothing to escape
+        keys.push_back(key + definitions[d] + "\":{\"n\":");
+    }
+    line.reserve(256 + 48 * definitions.size());
+}
+
+//==========================================================================
+// Numbers are formatted into the line without temporary strings. JSON has no NaN or infinity,
+// they become null.
+
+void JsonSummaryWriter::appendInteger(long long value) {
+    char digits[24];
+    int n = 0;
+    unsigned long long magnitude = value < 0 ? 0ull - value : value;
+    do digits[n++] = char('0' + magnitude % 10); while (magnitude /= 10);
+    if (value < 0) line.push_back('-');
+    while (n > 0) line.push_back(digits[--n]);
+}
+
+void JsonSummaryWriter::appendNumber(double value) {
+    if (!std::isfinite(value)) {
+        append("null", 4);
+        return;
+    }
+    if (value == std::floor(value) && std::fabs(value) < 1e15) {
+        appendInteger((long long) value);
+        return;
+    }
+    char text[32];
+    int n = snprintf(text, sizeof(text), "%.7g", value); //as precise as the float columns of the store
+    append(text, n);
+}
+
+void JsonSummaryWriter::write(long event, double weight, double pTHat, size_t multiplicity, EventJets &jets) {
+    line.clear();
+    append("{\"event\":", 9);
+    appendInteger(event);
+    append(",\"weight\":", 10);
+    appendNumber(weight);
+    append(",\"pTHat\":", 9);
+    appendNumber(pTHat);
+    append(",\"multiplicity\":", 16);
+    appendInteger(multiplicity);
+    append(",\"jets\":{", 9);
+    for (size_t d = 0; d < keys.size() && d < jets.size(); ++d) {
+        auto &result = jets.jets(d);
+        append(keys[d]);
+        appendInteger(result.size());
+        append(",\"leadingPt\":", 13);
+        appendNumber(result.empty() ? 0 : result[0].pt());
+        line.push_back('}');
+    }
+    append("}}\n", 3);
+    out.write(line.data(), line.size());
+    ++nEvents;
+}
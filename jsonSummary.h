@@ -0,0 +1,47 @@
+//
+// One JSON object per event and line (JSON Lines) for quick triage with jq, pandas or grep, e.g.
+//   {"event":12,"weight":1,"pTHat":43.21,"multiplicity":317,"jets":{"antikt_R03":{"n":4,"leadingPt":51.37}}}
+// with the number of jets and the leading jet pT of every definition. The line is put together in a
+// buffer reused from event to event, the numbers are formatted in place, and it is written through
+// AsyncWriter, so the cost per event is a few hundred bytes copied once the jets are clustered.
+//
+
+#ifndef PYTHIAPROJECT_JSONSUMMARY_H
+#define PYTHIAPROJECT_JSONSUMMARY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "asyncWriter.h"
+#include "eventJets.h"
+
+
+
+class JsonSummaryWriter {
+public:
+    JsonSummaryWriter(const std::string &file, const std::vector<std::string> &definitions,
+                      const WriterOptions &options = WriterOptions());
+    ~JsonSummaryWriter() { close(); }
+
+    bool good() const { return out.good(); }
+    long size() const { return nEvents; }
+    uint64_t bytes() const { return out.size(); }
+
+    //the jets in the order of the definitions
+    void write(long event, double weight, double pTHat, size_t multiplicity, EventJets &jets);
+    void close() { out.close(); }
+
+private:
+    void append(const char *text, size_t n) { line.insert(line.end(), text, text + n); }
+    void append(const std::string &text) { append(text.data(), text.size()); }
+    void appendInteger(long long value);
+    void appendNumber(double value);
+
+    AsyncWriter out;
+    std::vector<std::string> keys; //,"name":{"n": for every definition, ready to copy
+    std::vector<char> line;
+    long nEvents = 0;
+};
+
+#endif //PYTHIAPROJECT_JSONSUMMARY_H
@@ -1,6 +1,11 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <cstring>
+#include <chrono>
+#include <limits>
+
+#include <unistd.h>
 
 #include "Pythia8/Pythia.h"
 #include "TCanvas.h"
@@ -14,23 +19,87 @@
 #include "TStyle.h"
 #include "fastjet/PseudoJet.hh"
 #include "fastjet/ClusterSequence.hh"
+#include "Pythia8Plugins/HepMC3.h"
 
+#include "displayExport.h"
 #include "drawF.h"
-
-int main() {
+#include "eventJets.h"
+#include "eventReplay.h"
+#include "eventStore.h"
+#include "frameRenderer.h"
+#include "graphicsPool.h"
+#include "hepmcIO.h"
+#include "jetCatalog.h"
+#include "jsonSummary.h"
+#include "metrics.h"
+#include "mpiRun.h"
+#include "sharedSpectra.h"
+#include "shmRing.h"
+#include "spectra.h"
+#include "stageTimers.h"
+#include "treeOutput.h"
+#include "userSettings.h"
+#include "workQueue.h"
+
+int main(int argc, char *argv[]) {
+    //mpirun -np N main: every rank generates its share of the events, Mpi:*
+    MpiRun mpi(argc, argv);
 
     Pythia8::Pythia pythia;
+    addUserSettings(pythia.settings);
     pythia.readFile("../config1.cmnd");
+    if (mpi.distributed()) {
+        if (!pythia.word("Replay:file").empty() || !pythia.word("HepMC:input").empty()) {
+            if (mpi.root()) printf("Replay:file and HepMC:input are read by a single process, not with mpirun\n");
+            return 1;
+        }
+        pythia.readString("Random:setSeed = on");
+        pythia.readString("Random:seed = " + std::to_string(pythia.mode("Mpi:seed") + mpi.rank()));
+        for (auto key: {"Store:file", "Tree:file", "Catalog:file", "Ring:name", "Export:file", "Summary:file",
+                         "Timing:trace", "HepMC:output"})
+            pythia.settings.word(key, mpi.perRank(pythia.word(key)));
+    }
+    //event ranges with seeds of their own from workCoordinator until it has no more, Work:socket
+    WorkClient *work = nullptr;
+    if (!pythia.word("Work:socket").empty()) {
+        if (!pythia.word("Replay:file").empty() || !pythia.word("HepMC:input").empty()) {
+            printf("Replay:file and HepMC:input are not split into work units\n");
+            return 1;
+        }
+        work = new WorkClient(pythia.word("Work:socket"));
+        if (!work->good()) return 1;
+        for (auto key: {"Store:file", "Tree:file", "Catalog:file", "Ring:name", "Export:file", "Summary:file",
+                         "Timing:trace", "HepMC:output"})
+            if (!pythia.word(key).empty())
+                pythia.settings.word(key, pythia.word(key) + ".worker" + std::to_string(getpid()));
+    }
     pythia.init();
 
-    int nXBins = 400/2, nYBins = 314/2; //resolutions of 2D histogram
-    double nXMax = 4; //maximal rapidity value
+    //stored run replayed instead of pythia.next(), Replay:*
+    MappedEventStore *replay = nullptr;
+    if (!pythia.word("Replay:file").empty()) {
+        replay = new MappedEventStore(pythia.word("Replay:file"));
+        if (!replay->good()) return 1; //said why when mapping it
+    }
+    long nEvents = replay ? replay->size() : mpi.share(pythia.mode("Main:numberOfEvents"));
+    if (work) nEvents = std::numeric_limits<int>::max(); //until the coordinator runs out of units
+
+    //HepMC3 files, HepMC:*; an input file replaces pythia.next(), at most Main:numberOfEvents are read
+    HepMCReader *hepmcIn = nullptr;
+    Pythia8::Pythia8ToHepMC *hepmcOut = nullptr;
+    FinalState finalState;
+    if (!pythia.word("HepMC:input").empty() && !replay)
+        hepmcIn = new HepMCReader(pythia.word("HepMC:input"), pythia.mode("HepMC:queueSize"), pythia.particleData);
+    if (!pythia.word("HepMC:output").empty()) hepmcOut = new Pythia8::Pythia8ToHepMC(pythia.word("HepMC:output"));
+    bool generating = !replay && !hepmcIn;
+
+    Binning binning(pythia.settings); //resolution and range of the 2D histograms, Display:*
 
 
     setUpRootStyle();
     auto canvas = new TCanvas();
     canvas->SetMargin(0.06, 0.02, 0.08, 0.06);
-    auto pTflow = createTH2D(nXBins, nYBins, nXMax);
+    auto pTflow = createTH2D(binning);
 
     TString pdf = "../results/";
 
@@ -43,7 +112,10 @@ int main() {
     bool doK_t = true, doAntiK_t = true, doCambridgeAachen = false;
     double pTmin_jet = 5;
     double pTmin_hadron = 1, yMax = 4;
-    TString description = "Number of events: " + std::to_string(pythia.mode("Main:numberOfEvents"));
+    TString description = "Number of events: " + std::to_string(nEvents);
+    if (work) description = Form("Worker %d", getpid()); //the number is known at the end only
+    //with mpirun only the per-event spectra are summed, the other pages hold the events of rank 0
+    if (mpi.distributed()) description += Form(" of rank 0 only, %d ranks", mpi.size());
 
     //define jet finding algorithms here:
     jetDefs["Anti-#it{k_{t}} jets, #it{R} = " + std::to_string(R)] = fastjet::JetDefinition(
@@ -62,77 +134,508 @@ int main() {
     //                fastjet::cambridge_algorithm, R, fastjet::E_scheme, fastjet::Best);
     //till here
 
+    std::vector<std::string> jetNames; //as in the files, e.g. antikt_R03
+    for (auto &jetDef: jetDefs) jetNames.push_back(jetBranchName(jetDef.second).Data());
+
     auto &event = pythia.event;
     std::vector<Pythia8::Particle> particles_histogram;
     std::vector<fastjet::PseudoJet> stable_particles;
 
+    //wall-clock time per stage, the table is printed at the end, and a timeline of every stage, Timing:*
+    StageTimers timers(pythia.flag("Timing:report"));
+    if (!pythia.word("Timing:trace").empty()) timers.trace(pythia.mode("Timing:traceRecords"));
+    if (pythia.flag("Timing:counters")) timers.countHardware();
+    timers.nameThread("main");
+    int stageInput = timers.stage(replay ? "replay read" : hepmcIn ? "HepMC read" : "pythia.next()");
+    int stageSelection = timers.stage("final-state selection");
+    int stageGhosts = timers.stage("ghost construction");
+    std::vector<int> stageClustering;
+    for (auto &name: jetNames) stageClustering.push_back(timers.stage("clustering " + name));
+    int stageTree = timers.stage("tree output"), stageFill = timers.stage("spectra fill");
+    int stageCatalog = timers.stage("catalog"), stageRing = timers.stage("ring");
+    int stageExport = timers.stage("export"), stageSummary = timers.stage("summary");
+    int stageStore = timers.stage("store"), stageFrames = timers.stage("frames");
 
+    //Ghost are needed otherwise jet images is bad or not possible to find
+    ScopedTimer ghostTimer(timers, stageGhosts);
+    auto ghosts = makeGhosts(binning);
+    ghostTimer.stop();
+
+    //animated frames, the static layer is drawn once here
+    int framesMode = mpi.root() ? pythia.mode("Frames:mode") : 0; //one set of frames
+    TString frameJetName = "Anti-#it{k_{t}} jets, #it{R} = " + std::to_string(R);
+    TH2D *framesTH2D = nullptr;
+    FrameRenderer *frames = nullptr;
+    if (framesMode > 0) {
+        canvas->SetLogz();
+        canvas->SetRightMargin(0.14);
+        framesTH2D = createTH2D(binning);
+        framesTH2D->SetMinimum(pTmin_jet / 4);
+        framesTH2D->SetMaximum(pythia.parm("Frames:pTmax"));
+        framesTH2D->Draw("colz");
+        drawText(0.87, 0.96, frameJetName + Form(", #it{p}_{T} > %.0f GeV", pTmin_jet), 31);
+        drawdrawLegend();
+        frames = new FrameRenderer(canvas, framesTH2D, pythia.word("Frames:pattern"));
+        frames->captureStatic();
+        double x1, y1, x2, y2;
+        legendBoxNDC(x1, y1, x2, y2);
+        frames->protectArea(x1, y1, x2, y2);
+    }
 
-
-    for (int iEvent = 0; iEvent < pythia.mode("Main:numberOfEvents"); ++iEvent) { //choosing final particles only
+    //output files written in chunks by the kernel while the next chunk is filled, Output:*
+    WriterOptions writerOptions;
+    writerOptions.async = pythia.flag("Output:async");
+    writerOptions.chunkSize = pythia.mode("Output:chunkSize");
+    writerOptions.maxInFlight = pythia.mode("Output:maxInFlight");
+    writerOptions.fsync = pythia.flag("Output:fsync");
+
+    EventStoreWriter *store = nullptr;
+    auto storeJetDef = fastjet::JetDefinition(fastjet::antikt_algorithm, pythia.parm("Store:jetR"),
+                                              fastjet::E_scheme, fastjet::Best);
+    Quantization quantization; //Store:encoding = 1
+    quantization.pTprecision = pythia.parm("Store:pTprecision");
+    quantization.yStep = pythia.parm("Store:yPrecision");
+    quantization.phiStep = pythia.parm("Store:phiPrecision");
+    quantization.mStep = pythia.parm("Store:mPrecision");
+    if (!pythia.word("Store:file").empty() && generating)
+        store = new EventStoreWriter(pythia.word("Store:file"), pythia.mode("Store:precision"),
+                                     pythia.mode("Store:eventsPerBlock"), writerOptions,
+                                     pythia.mode("Store:encoding") == 1 ? &quantization : nullptr);
+
+    //TTree output of particles and jets of every event, Tree:*
+    TreeOutput *treeOutput = nullptr;
+    if (!pythia.word("Tree:file").empty())
+        treeOutput = new TreeOutput(pythia.word("Tree:file"), jetDefs, pTmin_jet, pythia.mode("Tree:nWorkers"),
+                                    pythia.mode("Tree:compression"), pythia.mode("Tree:basketSize"),
+                                    pythia.mode("Tree:autoFlush"), &timers);
+    FinalState treeEvent;
+
+    //jet catalog for jetQuery, Catalog:*
+    JetCatalogWriter *catalog = nullptr;
+    bool catalogArea = pythia.flag("Catalog:area");
+    if (!pythia.word("Catalog:file").empty())
+        catalog = new JetCatalogWriter(pythia.word("Catalog:file"), jetNames, writerOptions,
+                                       size_t(pythia.mode("Catalog:sortMemory")) << 20,
+                                       pythia.word("Catalog:spillDirectory"));
+
+    //events and jets for other processes, Ring:*
+    ShmRingProducer *ring = nullptr;
+    std::vector<char> ringRecord;
+    if (!pythia.word("Ring:name").empty())
+        ring = new ShmRingProducer(pythia.word("Ring:name"), pythia.mode("Ring:nSlots"), pythia.mode("Ring:slotSize"),
+                                   RingPolicy(pythia.mode("Ring:policy")));
+
+    //events for eventDisplay.html, Export:*
+    DisplayExporter *exporter = nullptr;
+    if (!pythia.word("Export:file").empty())
+        exporter = new DisplayExporter(pythia.word("Export:file"), binning, jetNames, pTmin_jet, pTmin_hadron,
+                                       writerOptions);
+
+    //a JSON line per event, Summary:*
+    JsonSummaryWriter *summaries = nullptr;
+    if (!pythia.word("Summary:file").empty())
+        summaries = new JsonSummaryWriter(pythia.word("Summary:file"), jetNames, writerOptions);
+
+    //jet spectra summed over all processes of the node which fill them, Shared:*
+    SharedSpectra *shared = nullptr;
+    if (!pythia.word("Shared:name").empty()) shared = new SharedSpectra(pythia.word("Shared:name"), jetNames);
+
+    //jets of the current event shared by the catalog, the ring, the export and the summaries, clustered once per
+    //definition
+    EventJets eventJets(jetDefs, pTmin_jet, catalogArea || exporter ? &ghosts : nullptr);
+
+    //Prometheus text file for the textfile collector of node_exporter, Metrics:*; the processes of a
+    //run write files of their own with a process label, e.g. metrics.rank1.prom
+    Metrics metrics(mpi.distributed() ? "rank" + std::to_string(mpi.rank())
+                                      : work ? "worker" + std::to_string(getpid()) : "");
+    MetricsFile *metricsFile = nullptr;
+    MetricCounter *eventsTotal = nullptr, *rejectedTotal = nullptr;
+    MetricHistogram *eventSeconds = nullptr;
+    std::vector<MetricHistogram *> clusteringSeconds;
+    MetricGauge *storeBytes = nullptr, *catalogBytes = nullptr, *exportBytes = nullptr, *summaryBytes = nullptr;
+    if (!pythia.word("Metrics:file").empty()) {
+        eventsTotal = &metrics.counter("pythiaproject_events_total", "Events processed");
+        rejectedTotal = &metrics.counter("pythiaproject_events_rejected_total",
+                                         "Events pythia.next() failed on, see Main:timesAllowErrors");
+        eventSeconds = &metrics.histogram("pythiaproject_event_seconds", "Time per processed event",
+                                          exponentialBounds(1e-4, 2, 16));
+        for (auto &name: jetNames)
+            clusteringSeconds.push_back(&metrics.histogram("pythiaproject_clustering_seconds",
+                                                           "Time per event to cluster the jets of a definition",
+                                                           exponentialBounds(1e-5, 2, 16),
+                                                           "definition=\"" + name + "\""));
+        if (treeOutput)
+            metrics.gauge("pythiaproject_queue_depth", "Items waiting in a queue between threads",
+                          [treeOutput]() { return double(treeOutput->queued()); }, "queue=\"tree\"");
+        if (hepmcIn)
+            metrics.gauge("pythiaproject_queue_depth", "Items waiting in a queue between threads",
+                          [hepmcIn]() { return double(hepmcIn->queued()); }, "queue=\"hepmc\"");
+        metrics.gauge("pythiaproject_resident_memory_bytes", "Resident set size", residentBytes);
+        if (store) storeBytes = &metrics.gauge("pythiaproject_output_bytes", "Bytes written", "output=\"store\"");
+        if (catalog)
+            catalogBytes = &metrics.gauge("pythiaproject_output_bytes", "Bytes written", "output=\"catalog\"");
+        if (exporter)
+            exportBytes = &metrics.gauge("pythiaproject_output_bytes", "Bytes written", "output=\"export\"");
+        if (summaries)
+            summaryBytes = &metrics.gauge("pythiaproject_output_bytes", "Bytes written", "output=\"summary\"");
+        std::string file = pythia.word("Metrics:file");
+        if (!metrics.process().empty()) {
+            size_t dot = file.size() > 5 && file.compare(file.size() - 5, 5, ".prom") == 0 ? file.size() - 5
+                                                                                           : file.size();
+            file.insert(dot, "." + metrics.process());
+        }
+        metricsFile = new MetricsFile(metrics, file, pythia.parm("Metrics:interval"));
+    }
+    if (!clusteringSeconds.empty())
+        eventJets.timeClustering([&](size_t d, double seconds) { clusteringSeconds[d]->observe(seconds); });
+
+    //per-event spectra of every rank and its counters, summed on rank 0 at the end and every
+    //Mpi:reduceEvery events without waiting; the same number of sums is started on every rank
+    std::map<TString, JetSpectra> eventSpectra;
+    long nAccepted = 0;
+    double sumWeights = 0;
+    auto packResults = [&]() {
+        std::vector<double> values = {double(nAccepted), sumWeights, pythia.info.sigmaGen() * nAccepted};
+        for (auto &jetDef: jetDefs) eventSpectra[jetDef.first].pack(values);
+        return values;
+    };
+    MpiReduction progress(mpi);
+    long reduceEvery = pythia.mode("Mpi:reduceEvery"), minShare = pythia.mode("Main:numberOfEvents") / mpi.size();
+    long nReductions = mpi.distributed() && reduceEvery > 0 && minShare > 0 ? (minShare - 1) / reduceEvery : 0;
+    long nStarted = 0;
+
+    auto reportProgress = [&]() {
+        if (progress.done() && mpi.root())
+            printf("Progress: %.0f events on %d ranks, sum of weights %g\n", progress.result()[0], mpi.size(),
+                   progress.result()[1]);
+    };
+
+    for (int iEvent = 0; iEvent < nEvents; ++iEvent) { //choosing final particles only
+        auto eventStart = std::chrono::steady_clock::now();
+        if (work && iEvent == work->end()) { //the unit is done, on with the next
+            if (!work->next()) break;
+            iEvent = work->unit().first;
+            pythia.rndm.init(int(work->unit().seed)); //the events of a unit do not depend on the worker
+        }
+        if (timers.tracing()) timers.setEvent(iEvent);
+        if (nStarted < nReductions && iEvent == (nStarted + 1) * reduceEvery) {
+            progress.wait(); //usually long done, unless another rank is far behind
+            reportProgress();
+            progress.start(packResults());
+            ++nStarted;
+        }
+        reportProgress();
         pTflow->Reset();
-        if (!pythia.next()) continue;
+        size_t eventBegin = particles_histogram.size();
+        ScopedTimer inputTimer(timers, stageInput);
+        if (replay) {
+            auto view = replay->event(iEvent);
+            appendPseudoJets(view, stable_particles);
+            appendParticles(view, pythia.particleData, particles_histogram);
+        } else if (hepmcIn) {
+            if (!hepmcIn->next(finalState)) break;
+            auto view = finalState.view();
+            appendPseudoJets(view, stable_particles);
+            appendParticles(view, pythia.particleData, particles_histogram);
+        } else {
+            if (!pythia.next()) {
+                if (rejectedTotal) rejectedTotal->add();
+                continue;
+            }
+            if (hepmcOut) hepmcOut->writeNextEvent(pythia);
+        }
+        inputTimer.stop();
+
+        if (generating) {
+            ScopedTimer selectionTimer(timers, stageSelection);
+            for (int i = 0; i < event.size(); ++i) {
+                auto &p = event[i];
+                if (not p.isFinal()) continue;
+                stable_particles.push_back(fastjet::PseudoJet(p.px(), p.py(), p.pz(), p.e()));
+                particles_histogram.push_back(p);
+            }
+        }
 
-        for (int i = 0; i < event.size(); ++i) {
-            auto &p = event[i];
-            if (not p.isFinal()) continue;
-            stable_particles.push_back(fastjet::PseudoJet(p.px(), p.py(), p.pz(), p.e()));
-            particles_histogram.push_back(p);
+        //weight, cross section and pTHat of the event, from the generator or the input it was read from
+        EventMeta meta{};
+        int32_t number = iEvent; //as stored or written in the input file
+        if (generating) {
+            meta = {pythia.info.weight(), pythia.info.sigmaGen(), pythia.info.pTHat()};
+        } else if (replay) {
+            auto view = replay->event(iEvent);
+            meta = {view.weight, view.sigma, view.pTHat};
+            number = view.number;
+        } else {
+            meta = {finalState.weight, finalState.sigma, finalState.pTHat};
+            number = finalState.number;
+        }
+        double weight = meta.weight;
+
+        if (treeOutput) {
+            ScopedTimer timer(timers, stageTree);
+            treeEvent.assign(particles_histogram.data() + eventBegin, particles_histogram.size() - eventBegin);
+            treeEvent.number = number;
+            treeEvent.weight = meta.weight;
+            treeEvent.sigma = meta.sigma;
+            treeEvent.pTHat = meta.pTHat;
+            treeOutput->push(treeEvent);
         }
-    } //move it to the end in order to split events
 
-    //Ghost are needed otherwise jet images is bad or not possible to find
-    fastjet::PseudoJet ghost;
-    double pTghost = 1e-100;
-    for (int iy = 1; iy <= 400 / 2; ++iy) {
-        for (int iphi = 1; iphi <= 314 / 2; ++iphi) {
-            double y = pTflow->GetXaxis()->GetBinCenter(iy);
-            double phi = pTflow->GetYaxis()->GetBinCenter(iphi);
-            ghost.reset_momentum_PtYPhiM(pTghost, y, phi, 0);
-            stable_particles.push_back(ghost);
+        if (catalog || ring || exporter || summaries || shared || mpi.distributed()) {
+            eventJets.reset(stable_particles.data() + eventBegin, stable_particles.size() - eventBegin);
+            for (size_t d = 0; d < eventJets.size(); ++d) { //all outputs take every definition
+                ScopedTimer timer(timers, stageClustering[d]);
+                eventJets.jets(d);
+            }
+        }
+        ++nAccepted;
+        sumWeights += weight;
+
+        ScopedTimer fillTimer(timers, stageFill);
+        if (shared)
+            for (size_t d = 0; d < eventJets.size(); ++d)
+                for (auto &jet: eventJets.jets(d)) shared->fill(d, jet, weight);
+
+        if (mpi.distributed()) {
+            size_t d = 0;
+            for (auto &jetDef: jetDefs)
+                for (auto &jet: eventJets.jets(d++)) eventSpectra[jetDef.first].fill(jet, weight);
+        }
+        fillTimer.stop();
+
+        if (catalog) {
+            ScopedTimer timer(timers, stageCatalog);
+            for (size_t d = 0; d < eventJets.size(); ++d) {
+                auto &jets = eventJets.jets(d);
+                for (size_t k = 0; k < jets.size(); ++k) {
+                    int nGhosts = 0;
+                    if (catalogArea)
+                        for (auto &c: jets[k].constituents()) nGhosts += c.pt() < 1e-50;
+                    JetRecord record{};
+                    record.pt = jets[k].pt(), record.y = jets[k].rap(), record.phi = jets[k].phi_std();
+                    record.mass = jets[k].m(), record.area = nGhosts * binning.cellArea();
+                    record.event = iEvent, record.definition = d, record.rank = k;
+                    record.flags = (k == 0 ? kLeadingJet : 0) |
+                                   (std::abs(jets[k].rap()) < binning.xMax - eventJets.definition(d).R() ? kFiducial : 0);
+                    catalog->add(record);
+                }
+            }
+        }
+
+        if (ring) {
+            ScopedTimer timer(timers, stageRing);
+            size_t nParticles = particles_histogram.size() - eventBegin, nJets = 0;
+            for (size_t d = 0; d < eventJets.size(); ++d) nJets += eventJets.jets(d).size();
+            RingEvent header{iEvent, uint32_t(nParticles), uint32_t(nJets), uint32_t(eventJets.size()), weight};
+            ringRecord.resize(sizeof(RingEvent) + nParticles * sizeof(RingParticle) + nJets * sizeof(RingJet));
+            char *out = ringRecord.data();
+            memcpy(out, &header, sizeof(header)), out += sizeof(header);
+            for (size_t i = eventBegin; i < particles_histogram.size(); ++i, out += sizeof(RingParticle)) {
+                auto &p = particles_histogram[i];
+                RingParticle particle{float(p.px()), float(p.py()), float(p.pz()), float(p.e()), p.id()};
+                memcpy(out, &particle, sizeof(particle));
+            }
+            for (size_t d = 0; d < eventJets.size(); ++d)
+                for (auto &jet: eventJets.jets(d)) {
+                    uint16_t nConstituents = 0;
+                    for (auto &c: jet.constituents()) nConstituents += c.pt() >= 1e-50; //without ghosts
+                    RingJet record{float(jet.pt()), float(jet.rap()), float(jet.phi_std()), float(jet.m()),
+                                   uint16_t(d), nConstituents};
+                    memcpy(out, &record, sizeof(record)), out += sizeof(record);
+                }
+            ring->publish(ringRecord.data(), ringRecord.size()); //too large for a slot - skipped
         }
+
+        if (exporter) {
+            ScopedTimer timer(timers, stageExport);
+            exporter->write(iEvent, weight, particles_histogram.data() + eventBegin,
+                            particles_histogram.size() - eventBegin, eventJets);
+        }
+
+        if (summaries) {
+            ScopedTimer timer(timers, stageSummary);
+            summaries->write(iEvent, weight, meta.pTHat, particles_histogram.size() - eventBegin, eventJets);
+        }
+
+        if (store) {
+            ScopedTimer timer(timers, stageStore);
+            std::vector<fastjet::PseudoJet> storeInput(stable_particles.begin() + eventBegin, stable_particles.end());
+            fastjet::ClusterSequence clustSeq(storeInput, storeJetDef);
+            auto jets = sorted_by_pt(clustSeq.inclusive_jets(pythia.parm("Store:pTminJet")));
+            EventSummary summary{};
+            summary.event = iEvent;
+            summary.nJets = jets.size();
+            summary.flavour = generating ? flavourTag(pythia.process) : 0; //the hard process is not read in
+            summary.leadingJetPt = jets.empty() ? 0 : jets[0].pt();
+            summary.weight = weight;
+            store->write(particles_histogram.data() + eventBegin, particles_histogram.size() - eventBegin,
+                         meta, summary);
+        }
+
+        bool historyEvent = framesMode == 2 && iEvent == pythia.mode("Frames:event");
+        if (framesMode == 1 || historyEvent) {
+            ScopedTimer timer(timers, stageFrames);
+            std::vector<fastjet::PseudoJet> frameInput(stable_particles.begin() + eventBegin, stable_particles.end());
+            frameInput.insert(frameInput.end(), ghosts.begin(), ghosts.end());
+            fastjet::ClusterSequence clustSeq(frameInput, jetDefs[frameJetName]);
+            auto jets = sorted_by_pt(clustSeq.inclusive_jets(pTmin_jet));
+            if (framesMode == 1) {
+                std::vector<Pythia8::Particle> eventParticles(particles_histogram.begin() + eventBegin,
+                                                              particles_histogram.end());
+                renderEventFrame(*frames, jets, eventParticles, pTmin_hadron, Form("Event %d", iEvent));
+            } else if (!jets.empty()) {
+                renderClusteringHistory(*frames, clustSeq, jets[0], pythia.mode("Frames:nSteps"));
+            }
+        }
+
+        if (metricsFile) {
+            eventsTotal->add();
+            eventSeconds->observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - eventStart).count());
+            if (storeBytes) storeBytes->set(store->bytes());
+            if (catalogBytes) catalogBytes->set(catalog->bytes());
+            if (exportBytes) exportBytes->set(exporter->bytes());
+            if (summaryBytes) summaryBytes->set(summaries->bytes());
+        }
+    } //move it to the end in order to split events
+    if (timers.tracing()) timers.setEvent(-1);
+
+    delete metricsFile; //written once more with the final counts
+    if (frames) printf("Produced %d frames %s\n\n", frames->nFrames(), pythia.word("Frames:pattern").c_str());
+    delete frames;
+    delete framesTH2D;
+    if (catalog) {
+        catalog->close();
+        printf("Catalogued %llu jets in %s\n\n", (unsigned long long) catalog->size(),
+               pythia.word("Catalog:file").c_str());
+    }
+    delete catalog;
+    if (ring) printf("Published %llu events to shared memory ring %s\n\n", (unsigned long long) ring->published(),
+                     pythia.word("Ring:name").c_str());
+    delete ring;
+    if (exporter) {
+        exporter->close();
+        printf("Exported %ld events to %s, open them in eventDisplay.html\n\n", exporter->size(),
+               pythia.word("Export:file").c_str());
+    }
+    delete exporter;
+    if (summaries) {
+        summaries->close();
+        printf("Summarised %ld events in %s\n\n", summaries->size(), pythia.word("Summary:file").c_str());
+    }
+    delete summaries;
+    if (shared) printf("Added the jets of %ld events to shared spectra %s%s\n\n", nAccepted,
+                       pythia.word("Shared:name").c_str(), shared->striped() ? "" : " (common sums)");
+    delete shared; //the stripe is added to the common sums
+    if (treeOutput) printf("Written %s\n\n", pythia.word("Tree:file").c_str());
+    delete treeOutput;
+    if (hepmcIn) printf("Read %ld events from %s\n\n", hepmcIn->nRead(), pythia.word("HepMC:input").c_str());
+    delete hepmcIn;
+    delete hepmcOut;
+    if (store) printf("Stored %d events in %s\n\n", store->size(), pythia.word("Store:file").c_str());
+    delete store;
+    if (work) {
+        printf("Generated %ld events in %ld work units from %s\n\n", nAccepted, work->nUnits(),
+               pythia.word("Work:socket").c_str());
+        work->finish(); //the outputs are closed, the units count
+    }
+    delete work;
+
+    //sums over the ranks, the pages are drawn by rank 0 alone, those of all ranks are the per-event spectra
+    TString spectraDescription = description;
+    if (mpi.distributed()) {
+        progress.wait();
+        reportProgress();
+        auto results = packResults();
+        mpi.sum(results);
+        if (!mpi.root()) {
+            if (timers.tracing()) timers.writeTrace(pythia.word("Timing:trace"));
+            delete pTflow;
+            delete canvas;
+            return 0;
+        }
+        const double *in = results.data() + 3;
+        for (auto &jetDef: jetDefs) eventSpectra[jetDef.first].unpack(in);
+        printf("Generated %.0f events on %d ranks, sigma = %.4g mb\n\n", results[0], mpi.size(),
+               results[0] > 0 ? results[2] / results[0] : 0.);
+        spectraDescription = Form("Number of events: %.0f on %d ranks", results[0], mpi.size());
+    }
+
+    //replayed events are also clustered one by one, in parallel, for spectra per event
+    if (replay) {
+        int nThreads = pythia.mode("Replay:nThreads");
+        std::vector<std::map<TString, JetSpectra>> threadSpectra(nThreads);
+        std::vector<std::vector<fastjet::PseudoJet>> inputs(nThreads);
+        std::vector<int> stages;
+        for (auto &name: jetNames) stages.push_back(timers.stage("replay clustering " + name));
+        fastjet::ClusterSequence::print_banner(); //not from the threads
+        replayParallel(*replay, nThreads, [&](int thread, long iEvent, const EventView &view) {
+            if (timers.tracing()) timers.nameThread("replay"), timers.setEvent(iEvent);
+            inputs[thread].clear();
+            appendPseudoJets(view, inputs[thread]);
+            size_t d = 0;
+            for (auto &jetDef: jetDefs) {
+                ScopedTimer timer(timers, stages[d++]);
+                fastjet::ClusterSequence clustSeq(inputs[thread], jetDef.second);
+                auto &spectra = threadSpectra[thread][jetDef.first];
+                for (auto &jet: clustSeq.inclusive_jets(pTmin_jet)) spectra.fill(jet, view.weight);
+            }
+        });
+        for (auto &spectra: threadSpectra)
+            for (auto &def: spectra) eventSpectra[def.first].add(def.second);
     }
 
+    stable_particles.insert(stable_particles.end(), ghosts.begin(), ghosts.end());
+
 
     canvas->SetLogz(); //log the z axis, so jets are more clearly seen
     canvas->SetRightMargin(0.14);
 
 
+    std::map<TString, JetSpectra> jetSpectra;
     for (auto jetDef: jetDefs) {
-        pTflow->Reset();
-
-
+        std::string name = jetBranchName(jetDef.second).Data();
+        ScopedTimer clusteringTimer(timers, timers.stage("page clustering " + name));
         fastjet::ClusterSequence clustSeq(stable_particles, jetDef.second);
         auto jets = sorted_by_pt(clustSeq.inclusive_jets(pTmin_jet));
-        // Fill the pT flow.
-        // For each jet:
-
-        for (auto jet: jets) {
-            // For each particle:
-            for (auto c: jet.constituents()) {
-                if (c.pt() > 1e-50) continue; //gets rid of bubbles in jets
-                pTflow->Fill(c.rap(), c.phi_std(), jet.pt());
-            }
-        }
+        clusteringTimer.stop();
 
-        pTflow->GetZaxis()->SetRangeUser(pTmin_jet / 4, pTflow->GetBinContent(pTflow->GetMaximumBin()) * 4);
-        pTflow->GetZaxis()->SetMoreLogLabels();
-        pTflow->Draw("colz");
+        auto &spectra = jetSpectra[jetDef.first];
+        for (auto &jet: jets) spectra.fill(jet);
 
-        drawParticles_histogram(particles_histogram, pTmin_hadron);
-
-        drawText(0.06, 0.96, description);
-        drawText(0.87, 0.96, jetDef.first +
-                          Form(", #it{p}_{T} > %.0f GeV", pTmin_jet), 31);
-        drawdrawLegend();
+        ScopedTimer drawingTimer(timers, timers.stage("page drawing " + name));
+        drawJetPage(pTflow, binning, jets, particles_histogram, pTmin_jet, pTmin_hadron, description, jetDef.first);
+        drawingTimer.stop();
+        ScopedTimer printTimer(timers, timers.stage("canvas->Print " + name));
         canvas->Print(pdf + "[" + description + "] " + jetDef.first + ".pdf");;
+        printTimer.stop();
         printf("Produced %s\n\n", pdf.Data());
     }
 
 
+    ScopedTimer spectraTimer(timers, timers.stage("spectra drawing and printing"));
+    auto spectraCanvas = new TCanvas();
+    spectraCanvas->SetMargin(0.1, 0.04, 0.1, 0.06);
+    for (auto &spectra: jetSpectra) {
+        drawJetSpectra(spectraCanvas, spectra.second, description, spectra.first,
+                       pdf + "[" + description + "] " + spectra.first + " spectra.pdf");
+    }
+    for (auto &spectra: eventSpectra) {
+        drawJetSpectra(spectraCanvas, spectra.second, spectraDescription, spectra.first,
+                       pdf + "[" + spectraDescription + "] " + spectra.first + " per-event spectra.pdf");
+    }
+    releaseGraphicsPool(spectraCanvas);
+    delete spectraCanvas;
+    spectraTimer.stop();
+    if (pythia.flag("Timing:report")) timers.report();
+    if (timers.counting()) timers.reportCounters(nAccepted, particles_histogram.size());
+    if (timers.tracing()) timers.writeTrace(pythia.word("Timing:trace"));
+
+
     //here '}' must be added in order to split events
     //part of code to turn off hello notifications
 
+    releaseGraphicsPool(canvas);
+    delete replay;
     delete pTflow;
     delete canvas;
 
@@ -0,0 +1,169 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include <unistd.h>
+
+
+
+MetricHistogram::MetricHistogram(std::vector<double> bounds)
+        : upper(std::move(bounds)), buckets(new std::atomic<uint64_t>[upper.size() + 1]) {
+    std::sort(upper.begin(), upper.end());
+    for (size_t i = 0; i <= upper.size(); ++i) buckets[i].store(0, std::memory_order_relaxed);
+}
+
+void MetricHistogram::observe(double v) {
+    size_t i = std::lower_bound(upper.begin(), upper.end(), v) - upper.begin();
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+    double old = total.load(std::memory_order_relaxed);
+    while (!total.compare_exchange_weak(old, old + v, std::memory_order_relaxed)) {}
+}
+
+std::vector<uint64_t> MetricHistogram::counts() const {
+    std::vector<uint64_t> result(upper.size() + 1);
+    for (size_t i = 0; i < result.size(); ++i) result[i] = buckets[i].load(std::memory_order_relaxed);
+    return result;
+}
+
+std::vector<double> exponentialBounds(double first, double factor, int n) {
+    std::vector<double> bounds;
+    for (double bound = first; int(bounds.size()) < n; bound *= factor) bounds.push_back(bound);
+    return bounds;
+}
+
+//==========================================================================
+// Registry
+
+Metrics::Series &Metrics::add(const std::string &name, const std::string &help, Type type,
+                              const std::string &labels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto family = std::find_if(families.begin(), families.end(), [&](const Family &f) { return f.name == name; });
+    if (family == families.end()) {
+        families.push_back(Family{name, help, type, {}});
+        family = families.end() - 1;
+    }
+    family->series.emplace_back();
+    family->series.back().labels = labels;
+    return family->series.back();
+}
+
+MetricCounter &Metrics::counter(const std::string &name, const std::string &help, const std::string &labels) {
+    auto &series = add(name, help, kCounter, labels);
+    series.counter.reset(new MetricCounter());
+    return *series.counter;
+}
+
+MetricGauge &Metrics::gauge(const std::string &name, const std::string &help, const std::string &labels) {
+    auto &series = add(name, help, kGauge, labels);
+    series.gauge.reset(new MetricGauge());
+    return *series.gauge;
+}
+
+void Metrics::gauge(const std::string &name, const std::string &help, std::function<double()> sample,
+                    const std::string &labels) {
+    add(name, help, kGauge, labels).sample = std::move(sample);
+}
+
+MetricHistogram &Metrics::histogram(const std::string &name, const std::string &help, std::vector<double> bounds,
+                                    const std::string &labels) {
+    auto &series = add(name, help, kHistogram, labels);
+    series.histogram.reset(new MetricHistogram(std::move(bounds)));
+    return *series.histogram;
+}
+
+//==========================================================================
+// Exposition format: # HELP and # TYPE once per name, then one line per series; histograms as
+// cumulative _bucket{le=...} series, _sum and _count.
+
+static std::string number(double v) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.15g", v);
+    return buffer;
+}
+
+static std::string braces(const std::string &labels, const std::string &more = "") {
+    if (labels.empty() && more.empty()) return "";
+    return "{" + labels + (labels.empty() || more.empty() ? "" : ",") + more + "}";
+}
+
+std::string Metrics::text() const {
+    static const char *types[] = {"counter", "gauge", "histogram"};
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string out;
+    for (auto &family: families) {
+        out += "# HELP " + family.name + " " + family.help + "\n";
+        out += "# TYPE " + family.name + " " + types[family.type] + "\n";
+        for (auto &series: family.series) {
+            std::string labels = series.labels;
+            if (!processName.empty())
+                labels = "process=\"" + processName + "\"" + (labels.empty() ? "" : ",") + labels;
+            if (series.histogram) {
+                auto counts = series.histogram->counts();
+                auto &bounds = series.histogram->bounds();
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i < counts.size(); ++i) {
+                    cumulative += counts[i];
+                    std::string le = "le=\"" + (i < bounds.size() ? number(bounds[i]) : "+Inf") + "\"";
+                    out += family.name + "_bucket" + braces(labels, le) + " " + std::to_string(cumulative) + "\n";
+                }
+                out += family.name + "_sum" + braces(labels) + " " + number(series.histogram->sum()) + "\n";
+                out += family.name + "_count" + braces(labels) + " " + std::to_string(cumulative) + "\n";
+            } else {
+                double v = series.counter ? series.counter->get() : series.gauge ? series.gauge->get()
+                                                                                 : series.sample();
+                out += family.name + braces(labels) + " " + number(v) + "\n";
+            }
+        }
+    }
+    return out;
+}
+
+bool Metrics::write(const std::string &file) const {
+    std::string text = this->text(), temporary = file + ".tmp"; //same directory, so rename() is atomic
+    FILE *out = fopen(temporary.c_str(), "w");
+    if (!out) return false;
+    bool ok = fwrite(text.data(), 1, text.size(), out) == text.size();
+    ok = fclose(out) == 0 && ok;
+    if (ok) ok = rename(temporary.c_str(), file.c_str()) == 0;
+    if (!ok) remove(temporary.c_str());
+    return ok;
+}
+
+//==========================================================================
+// Writing thread
+
+MetricsFile::MetricsFile(const Metrics &metrics, const std::string &file, double interval)
+        : metrics(metrics), file(file) {
+    writer = std::thread([this, interval]() {
+        bool warned = false;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            bool last = wake.wait_for(lock, std::chrono::duration<double>(interval), [this]() { return stopping; });
+            if (!this->metrics.write(this->file) && !warned) {
+                printf("Cannot write metrics to %s\n", this->file.c_str());
+                warned = true;
+            }
+            if (last) break;
+        }
+    });
+}
+
+MetricsFile::~MetricsFile() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+}
+
+double residentBytes() {
+    long pages = 0, resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (!statm) return 0;
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    fclose(statm);
+    return double(resident) * sysconf(_SC_PAGESIZE);
+}
@@ -0,0 +1,122 @@
+//
+// Counters, gauges and histograms of a running job in the Prometheus text format, rewritten every
+// few seconds into a file for the textfile collector of node_exporter (see Metrics:file). Updates
+// are relaxed atomic operations without locks, so they can stay on the hot path; the metrics are
+// registered once before it and keep their address. Rates such as events/s are left to PromQL,
+// e.g. rate(pythiaproject_events_total[1m]).
+//
+
+#ifndef PYTHIAPROJECT_METRICS_H
+#define PYTHIAPROJECT_METRICS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+
+class MetricCounter {
+public:
+    void add(double v = 1) {
+        double old = value.load(std::memory_order_relaxed);
+        while (!value.compare_exchange_weak(old, old + v, std::memory_order_relaxed)) {}
+    }
+    double get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value{0};
+};
+
+class MetricGauge {
+public:
+    void set(double v) { value.store(v, std::memory_order_relaxed); }
+    double get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value{0};
+};
+
+// Counts per bucket (value <= bound), cumulated when written as Prometheus expects.
+class MetricHistogram {
+public:
+    explicit MetricHistogram(std::vector<double> bounds);
+
+    void observe(double v);
+    const std::vector<double> &bounds() const { return upper; }
+    std::vector<uint64_t> counts() const; //per bucket, the last one above all bounds
+    double sum() const { return total.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<double> upper;
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+    std::atomic<double> total{0};
+};
+
+std::vector<double> exponentialBounds(double first, double factor, int n);
+
+// Labels are given ready, e.g. definition="antikt_R03"; series of one name share help and type.
+class Metrics {
+public:
+    explicit Metrics(std::string process = "") : processName(std::move(process)) {} //process="..." on every series
+    const std::string &process() const { return processName; }
+
+    MetricCounter &counter(const std::string &name, const std::string &help, const std::string &labels = "");
+    MetricGauge &gauge(const std::string &name, const std::string &help, const std::string &labels = "");
+    //asked for its value when the metrics are written, from the writing thread
+    void gauge(const std::string &name, const std::string &help, std::function<double()> sample,
+               const std::string &labels = "");
+    MetricHistogram &histogram(const std::string &name, const std::string &help, std::vector<double> bounds,
+                               const std::string &labels = "");
+
+    std::string text() const; //the exposition format
+    bool write(const std::string &file) const; //through a temporary file and rename(), never seen half written
+
+private:
+    enum Type { kCounter, kGauge, kHistogram };
+    struct Series {
+        std::string labels;
+        std::unique_ptr<MetricCounter> counter;
+        std::unique_ptr<MetricGauge> gauge;
+        std::function<double()> sample;
+        std::unique_ptr<MetricHistogram> histogram;
+    };
+    struct Family {
+        std::string name, help;
+        Type type;
+        std::deque<Series> series;
+    };
+
+    Series &add(const std::string &name, const std::string &help, Type type, const std::string &labels);
+
+    std::string processName;
+    mutable std::mutex mutex; //registration against writing, not the updates
+    std::deque<Family> families;
+};
+
+// Rewrites the file every interval seconds in a thread of its own and once more when destroyed.
+class MetricsFile {
+public:
+    MetricsFile(const Metrics &metrics, const std::string &file, double interval);
+    ~MetricsFile();
+    MetricsFile(const MetricsFile &) = delete;
+    MetricsFile &operator=(const MetricsFile &) = delete;
+
+private:
+    const Metrics &metrics;
+    std::string file;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread writer;
+};
+
+double residentBytes(); //of this process, from /proc/self/statm; 0 where there is none
+
+#endif //PYTHIAPROJECT_METRICS_H
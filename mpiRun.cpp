@@ -0,0 +1,91 @@
+#include "mpiRun.h"
+
+#ifdef PYTHIAPROJECT_MPI
+#include <mpi.h>
+#endif
+
+
+
+MpiRun::MpiRun(int &argc, char **&argv) {
+#ifdef PYTHIAPROJECT_MPI
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &iRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nRanks);
+#else
+    (void) argc, (void) argv;
+#endif
+}
+
+MpiRun::~MpiRun() {
+#ifdef PYTHIAPROJECT_MPI
+    MPI_Finalize();
+#endif
+}
+
+long MpiRun::share(long nEvents) const {
+    return nEvents / nRanks + (iRank < nEvents % nRanks);
+}
+
+std::string MpiRun::perRank(const std::string &name) const {
+    if (!distributed() || name.empty()) return name;
+    return name + ".rank" + std::to_string(iRank);
+}
+
+void MpiRun::sum(std::vector<double> &values) const {
+#ifdef PYTHIAPROJECT_MPI
+    if (!distributed()) return;
+    MPI_Reduce(root() ? MPI_IN_PLACE : values.data(), values.data(), int(values.size()), MPI_DOUBLE, MPI_SUM, 0,
+               MPI_COMM_WORLD);
+#else
+    (void) values;
+#endif
+}
+
+//==========================================================================
+// Nonblocking reduction. The values are copied, so the caller can go on filling its histograms
+// while the sums travel.
+
+MpiReduction::~MpiReduction() {
+    wait();
+#ifdef PYTHIAPROJECT_MPI
+    delete (MPI_Request *) request;
+#endif
+}
+
+void MpiReduction::start(const std::vector<double> &values) {
+    wait();
+    this->values = values;
+    sums.assign(values.size(), 0);
+    running = true, completed = false;
+#ifdef PYTHIAPROJECT_MPI
+    if (run.distributed()) {
+        if (!request) request = new MPI_Request;
+        MPI_Ireduce(this->values.data(), sums.data(), int(values.size()), MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD,
+                    (MPI_Request *) request);
+        return;
+    }
+#endif
+    sums = values; //a single rank has its sums already
+}
+
+bool MpiReduction::done() {
+#ifdef PYTHIAPROJECT_MPI
+    if (running && run.distributed()) {
+        int finished = 0;
+        MPI_Test((MPI_Request *) request, &finished, MPI_STATUS_IGNORE);
+        if (!finished) return false;
+    }
+#endif
+    if (running) running = false, completed = true;
+    bool result = completed;
+    completed = false;
+    return result;
+}
+
+void MpiReduction::wait() {
+    if (!running) return;
+#ifdef PYTHIAPROJECT_MPI
+    if (run.distributed()) MPI_Wait((MPI_Request *) request, MPI_STATUS_IGNORE);
+#endif
+    running = false, completed = true;
+}
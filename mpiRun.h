@@ -0,0 +1,59 @@
+//
+// One production spread over several processes started by mpirun: every rank generates its own share
+// of the events with its own seed, and the histograms and counters are summed on rank 0 as flat
+// arrays of doubles. Compiled with mpicxx -DPYTHIAPROJECT_MPI; without it there is a single rank and
+// nothing is sent anywhere.
+//
+
+#ifndef PYTHIAPROJECT_MPIRUN_H
+#define PYTHIAPROJECT_MPIRUN_H
+
+#include <string>
+#include <vector>
+
+
+
+class MpiRun {
+public:
+    MpiRun(int &argc, char **&argv); //MPI_Init
+    ~MpiRun();                       //MPI_Finalize
+    MpiRun(const MpiRun &) = delete;
+    MpiRun &operator=(const MpiRun &) = delete;
+
+    int rank() const { return iRank; }
+    int size() const { return nRanks; }
+    bool root() const { return iRank == 0; }
+    bool distributed() const { return nRanks > 1; }
+
+    long share(long nEvents) const; //events generated by this rank, the ranks together generate nEvents
+    std::string perRank(const std::string &name) const; //name.rank<N> if distributed, every rank writes its own
+    void sum(std::vector<double> &values) const; //MPI_Reduce, the sums end up in values of rank 0
+
+private:
+    int iRank = 0, nRanks = 1;
+};
+
+// Nonblocking sums to rank 0 (MPI_Ireduce) for intermediate results while the ranks keep generating.
+// Every rank has to start the same number of reductions with the same number of values, in the same order.
+class MpiReduction {
+public:
+    explicit MpiReduction(const MpiRun &run) : run(run) {}
+    ~MpiReduction();
+    MpiReduction(const MpiReduction &) = delete;
+    MpiReduction &operator=(const MpiReduction &) = delete;
+
+    void start(const std::vector<double> &values); //copies the values, waits for the previous reduction first
+    bool done(); //true once after the last started reduction has completed; then result() is valid on rank 0
+    void wait(); //completes the last started reduction, done() tells it afterwards
+    const std::vector<double> &result() const { return sums; }
+
+private:
+    const MpiRun &run;
+    std::vector<double> values, sums;
+    bool running = false, completed = false;
+#ifdef PYTHIAPROJECT_MPI
+    void *request = nullptr; //MPI_Request, mpi.h stays out of the header
+#endif
+};
+
+#endif //PYTHIAPROJECT_MPIRUN_H
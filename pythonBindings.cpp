@@ -0,0 +1,129 @@
+//
+// Python module pythiajets: event generation, particle selection and jet clustering in batches of
+// events, with the particle and jet columns returned as NumPy arrays over the C++ buffers.
+//
+//   import pythiajets
+//   gen = pythiajets.Generator("../config1.cmnd", [("antikt", 0.3), ("kt", 0.3)], pt_min_jet=5, eta_max=4)
+//   batch = gen.generate(1000)               # one call per 1000 events, the GIL is released meanwhile
+//   batch.px, batch.particle_offsets         # numpy.ndarray views, valid as long as any of them lives
+//   batch.charge                             # in units of e/3, as in the event store
+//   jets = batch.jets[0]; jets.pt[jets.offsets[:-1][np.diff(jets.offsets) > 0]]   # leading jet pT
+//   pythiajets.cluster(px, py, pz, e, offsets, [("antikt", 0.4)], 10)   # clustering of own particles
+//
+// Built as a shared library from pythonBindings.cpp, eventBatch.cpp, eventJets.cpp and userSettings.cpp:
+//   c++ -O2 -shared -fPIC $(python3 -m pybind11 --includes) ... -o pythiajets$(python3-config --extension-suffix)
+// with the Pythia, FastJet and ROOT flags of main.cpp.
+//
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include "eventBatch.h"
+
+namespace py = pybind11;
+
+
+
+using JetDefinitionList = std::vector<std::tuple<std::string, double>>;
+
+static std::vector<fastjet::JetDefinition> jetDefinitions(const JetDefinitionList &list) {
+    std::vector<fastjet::JetDefinition> jetDefs;
+    for (auto &definition: list) jetDefs.push_back(jetDefinition(std::get<0>(definition), std::get<1>(definition)));
+    return jetDefs;
+}
+
+// A 1D array over the column, owner is the Python object keeping the column alive.
+template<class T>
+static py::array_t<T> view(const std::vector<T> &column, py::handle owner) {
+    return py::array_t<T>({column.size()}, {sizeof(T)}, column.data(), owner);
+}
+
+template<class Class, class T, class C>
+static void defineColumn(Class &cls, const char *name, std::vector<C> T::*column) {
+    cls.def_property_readonly(name, [column](py::object self) { return view(self.cast<T &>().*column, self); });
+}
+
+template<class T>
+static const T *columnData(const py::array_t<T, py::array::c_style | py::array::forcecast> &array) {
+    return array.data();
+}
+
+PYBIND11_MODULE(pythiajets, m) {
+    m.doc() = "Pythia event generation and FastJet clustering in batches, NumPy views of the results";
+
+    py::class_<EventBatch::Jets> jets(m, "Jets");
+    defineColumn(jets, "pt", &EventBatch::Jets::pt);
+    defineColumn(jets, "y", &EventBatch::Jets::y);
+    defineColumn(jets, "phi", &EventBatch::Jets::phi);
+    defineColumn(jets, "m", &EventBatch::Jets::m);
+    defineColumn(jets, "n_constituents", &EventBatch::Jets::nConstituents);
+    defineColumn(jets, "offsets", &EventBatch::Jets::offsets);
+
+    py::class_<EventBatch, std::shared_ptr<EventBatch>> batch(m, "EventBatch");
+    batch.def("__len__", &EventBatch::size);
+    defineColumn(batch, "number", &EventBatch::number);
+    defineColumn(batch, "weight", &EventBatch::weight);
+    defineColumn(batch, "px", &EventBatch::px);
+    defineColumn(batch, "py", &EventBatch::py);
+    defineColumn(batch, "pz", &EventBatch::pz);
+    defineColumn(batch, "e", &EventBatch::e);
+    defineColumn(batch, "id", &EventBatch::id);
+    defineColumn(batch, "charge", &EventBatch::charge);
+    defineColumn(batch, "particle_offsets", &EventBatch::particleOffsets);
+    //the Jets objects are parts of the batch, they keep it alive and with it their columns
+    batch.def_property_readonly("jets", [](py::object self) {
+        py::list list;
+        for (auto &definition: self.cast<EventBatch &>().jets)
+            list.append(py::cast(&definition, py::return_value_policy::reference_internal, self));
+        return list;
+    });
+
+    py::class_<BatchGenerator, std::shared_ptr<BatchGenerator>>(m, "Generator")
+            .def(py::init([](const std::string &cmndFile, const JetDefinitionList &jetDefs, double pTmin_jet,
+                             double pTmin, double etaMax, bool chargedOnly) {
+                     return std::make_shared<BatchGenerator>(cmndFile, jetDefinitions(jetDefs), pTmin_jet,
+                                                             ParticleSelection{pTmin, etaMax, chargedOnly});
+                 }), py::arg("cmnd_file"), py::arg("jet_definitions") = JetDefinitionList{{"antikt", 0.3}},
+                 py::arg("pt_min_jet") = 5., py::arg("pt_min") = 0., py::arg("eta_max") = 1e30,
+                 py::arg("charged_only") = false)
+            .def("generate", [](BatchGenerator &generator, long nEvents) {
+                auto batch = std::make_shared<EventBatch>();
+                py::gil_scoped_release release;
+                generator.generate(nEvents, *batch);
+                return batch;
+            }, py::arg("n_events"), "Generates n_events events, failed ones are skipped")
+            .def("read_string", [](BatchGenerator &generator, const std::string &line) {
+                return generator.pythia.readString(line);
+            }, "Pythia setting, only those read by init() need a new Generator");
+
+    using Column = py::array_t<double, py::array::c_style | py::array::forcecast>;
+    using Offsets = py::array_t<uint64_t, py::array::c_style | py::array::forcecast>;
+    m.def("cluster", [](const Column &pxColumn, const Column &pyColumn, const Column &pzColumn, const Column &eColumn,
+                        const Offsets &offsets, const JetDefinitionList &jetDefs, double pTmin_jet) {
+        size_t nEvents = offsets.size() ? offsets.size() - 1 : 0, n = pxColumn.size();
+        if (size_t(pyColumn.size()) != n || size_t(pzColumn.size()) != n || size_t(eColumn.size()) != n)
+            throw py::value_error("particle columns of different lengths");
+        for (size_t i = 0; i < nEvents; ++i)
+            if (offsets.data()[i] > offsets.data()[i + 1])
+                throw py::value_error("offsets have to be non-decreasing");
+        if (nEvents && offsets.data()[nEvents] > n)
+            throw py::value_error("particle columns shorter than the offsets say");
+        auto batch = std::make_shared<EventBatch>();
+        for (size_t i = 0; i < nEvents; ++i) batch->number.push_back(i);
+        EventJets eventJets(jetDefinitions(jetDefs), pTmin_jet);
+        {
+            py::gil_scoped_release release;
+            clusterEvents(columnData(pxColumn), columnData(pyColumn), columnData(pzColumn), columnData(eColumn),
+                          columnData(offsets), nEvents, eventJets, batch->jets);
+        }
+        return batch;
+    }, py::arg("px"), py::arg("py"), py::arg("pz"), py::arg("e"), py::arg("offsets"),
+          py::arg("jet_definitions") = JetDefinitionList{{"antikt", 0.3}}, py::arg("pt_min_jet") = 5.,
+          "Jets of events given as particle columns, the particles of event i are offsets[i]:offsets[i + 1]");
+}
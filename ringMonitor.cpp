@@ -0,0 +1,80 @@
+//
+// Attaches to the shared memory ring of a running main (see Ring:name) and prints, every second,
+// the event rate, the mean multiplicity, the mean leading jet pT per jet definition and the number
+// of records it lost. An example consumer, without ROOT.
+//
+//   ringMonitor <name> [--seconds n]
+//
+// Built from ringMonitor.cpp and shmRing.cpp (-lrt with older glibc).
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+
+#include "shmRing.h"
+
+
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <name> [--seconds n]\n", argv[0]);
+        return 1;
+    }
+    double seconds = 1e30;
+    for (int i = 2; i + 1 < argc; i += 2)
+        if (!strcmp(argv[i], "--seconds")) seconds = atof(argv[i + 1]);
+
+    ShmRingConsumer ring(argv[1]);
+    if (!ring.good()) return 1;
+
+    std::vector<char> record;
+    long nEvents = 0, nParticles = 0;
+    std::vector<double> leadingPt;
+    std::vector<long> nLeading;
+    auto start = std::chrono::steady_clock::now(), last = start;
+    for (;;) {
+        auto result = ring.next(record);
+        if (result == ShmRingConsumer::kRecord && record.size() >= sizeof(RingEvent)) {
+            RingEvent header;
+            memcpy(&header, record.data(), sizeof(header));
+            leadingPt.resize(header.nDefinitions), nLeading.resize(header.nDefinitions);
+            ++nEvents, nParticles += header.nParticles;
+            //jets are sorted by pT within a definition, the first one of each is the leading jet
+            const char *jets = record.data() + sizeof(RingEvent) + header.nParticles * sizeof(RingParticle);
+            int previous = -1;
+            for (uint32_t j = 0; j < header.nJets; ++j) {
+                RingJet jet;
+                memcpy(&jet, jets + j * sizeof(RingJet), sizeof(jet));
+                if (jet.definition == previous || jet.definition >= leadingPt.size()) continue;
+                previous = jet.definition;
+                leadingPt[jet.definition] += jet.pt, ++nLeading[jet.definition];
+            }
+        } else if (result == ShmRingConsumer::kEmpty) {
+            usleep(1000);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        double interval = std::chrono::duration<double>(now - last).count();
+        if (interval >= 1 || result == ShmRingConsumer::kClosed) {
+            printf("%8.2f events/s  <multiplicity> = %7.1f  <leading pT> =", nEvents / interval,
+                   nEvents ? double(nParticles) / nEvents : 0.);
+            for (size_t d = 0; d < leadingPt.size(); ++d)
+                printf(" %7.2f", nLeading[d] ? leadingPt[d] / nLeading[d] : 0.);
+            printf("  dropped %llu\n", (unsigned long long) ring.dropped());
+            nEvents = nParticles = 0;
+            std::fill(leadingPt.begin(), leadingPt.end(), 0.), std::fill(nLeading.begin(), nLeading.end(), 0);
+            last = now;
+        }
+        if (result == ShmRingConsumer::kClosed || std::chrono::duration<double>(now - start).count() > seconds)
+            break;
+    }
+    printf("Dropped %llu records in total\n", (unsigned long long) ring.dropped());
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+#include "sharedSpectra.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+static_assert(std::atomic<double>::is_always_lock_free, "shared sums need lock-free atomic doubles");
+
+static const char spectraMagic[8] = {'P', 'P', 'S', 'H', 'S', 'P', 'E', 'C'};
+
+static std::string shmName(const std::string &name) { return name[0] == '/' ? name : "/" + name; }
+
+static size_t dataOffset() { return (sizeof(SharedSpectraHeader) + 63) / 64 * 64; }
+
+static void atomicAdd(std::atomic<double> &sum, double w) {
+    double old = sum.load(std::memory_order_relaxed);
+    while (!sum.compare_exchange_weak(old, old + w, std::memory_order_relaxed)) {}
+}
+
+static uint64_t layoutHash(const std::vector<std::string> &definitions, const JetSpectra &binning) {
+    uint64_t hash = 14695981039346656037ull; //FNV-1a
+    auto mix = [&hash](const void *data, size_t n) {
+        for (size_t i = 0; i < n; ++i) hash = (hash ^ ((const unsigned char *) data)[i]) * 1099511628211ull;
+    };
+    for (auto &name: definitions) mix(name.c_str(), name.size() + 1);
+    for (auto spectrum: {&binning.pT, &binning.mass, &binning.multiplicity})
+        mix(spectrum->axis.edges().data(), spectrum->axis.edges().size() * sizeof(double));
+    return hash;
+}
+
+SharedSpectra::SharedSpectra(const std::string &name, const std::vector<std::string> &definitions) {
+    attach(name, true, definitions);
+}
+
+SharedSpectra::SharedSpectra(const std::string &name) {
+    attach(name, false, {});
+}
+
+//==========================================================================
+// Whoever comes first creates the segment, the others wait until its header is complete. The
+// values are zero from ftruncate.
+
+void SharedSpectra::attach(const std::string &name, bool create, const std::vector<std::string> &definitions) {
+    pTsize = 2 * (binning.pT.axis.n() + 2) + 1;
+    massSize = 2 * (binning.mass.axis.n() + 2) + 1;
+    perDefinition = pTsize + massSize + 2 * (binning.multiplicity.axis.n() + 2) + 1;
+    if (definitions.size() > kMaxSharedDefinitions) {
+        printf("Shared spectra take at most %d jet definitions\n", kMaxSharedDefinitions);
+        return;
+    }
+    uint64_t layout = layoutHash(definitions, binning);
+    std::string shm = shmName(name);
+
+    int fd = create ? shm_open(shm.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644) : -1;
+    if (fd >= 0) {
+        uint32_t nValues = definitions.size() * perDefinition;
+        length = dataOffset() + (1 + kMaxSharedStripes) * size_t(nValues) * sizeof(double);
+        void *address = ftruncate(fd, length) == 0 ? mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                                                   : MAP_FAILED;
+        close(fd);
+        if (address == MAP_FAILED) {
+            printf("Cannot create shared spectra %s: %s\n", shm.c_str(), strerror(errno));
+            shm_unlink(shm.c_str());
+            return;
+        }
+        header = static_cast<SharedSpectraHeader *>(address);
+        header->layout = layout;
+        header->nValues = nValues;
+        header->nDefinitions = definitions.size();
+        for (size_t d = 0; d < definitions.size(); ++d)
+            strncpy(header->definitions[d], definitions[d].c_str(), sizeof(header->definitions[d]) - 1);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(header->magic, spectraMagic, 8);
+    } else {
+        for (int nWaits = 0; nWaits < 1000 && !header; ++nWaits) { //the creator may be half way
+            fd = shm_open(shm.c_str(), O_RDWR, 0);
+            struct stat info{};
+            if (fd >= 0 && fstat(fd, &info) == 0 && size_t(info.st_size) >= dataOffset()) {
+                void *address = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                if (address != MAP_FAILED) {
+                    header = static_cast<SharedSpectraHeader *>(address);
+                    length = info.st_size;
+                    if (memcmp(header->magic, spectraMagic, 8) != 0) munmap(address, length), header = nullptr;
+                }
+            }
+            if (fd >= 0) close(fd);
+            if (!header) usleep(1000);
+        }
+        if (!header) {
+            printf("Cannot open shared spectra %s\n", shm.c_str());
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (create && header->layout != layout) {
+            printf("Shared spectra %s were made with other jet definitions or bins, remove them first "
+                   "(spectraMonitor %s --remove)\n", shm.c_str(), name.c_str());
+            munmap(header, length);
+            header = nullptr;
+            return;
+        }
+    }
+    for (uint32_t d = 0; d < header->nDefinitions; ++d)
+        names.emplace_back(header->definitions[d], strnlen(header->definitions[d], sizeof(header->definitions[d])));
+    common = reinterpret_cast<std::atomic<double> *>(reinterpret_cast<char *>(header) + dataOffset());
+    if (!create) return;
+
+    //a free stripe, else one of a process which died
+    int32_t pid = getpid();
+    for (int s = 0; s < kMaxSharedStripes && stripe < 0; ++s) {
+        int32_t free = 0;
+        if (header->owners[s].compare_exchange_strong(free, pid)) stripe = s;
+    }
+    for (int s = 0; s < kMaxSharedStripes && stripe < 0; ++s) {
+        int32_t owner = header->owners[s].load(std::memory_order_acquire);
+        bool dead = owner != 0 && kill(owner, 0) != 0 && errno == ESRCH;
+        if (dead && header->owners[s].compare_exchange_strong(owner, pid)) {
+            fold(s);
+            stripe = s;
+        }
+    }
+    if (stripe >= 0) own = common + size_t(1 + stripe) * header->nValues;
+    else printf("All %d stripes of shared spectra %s are taken, adding to the common sums\n", kMaxSharedStripes,
+                shm.c_str());
+}
+
+SharedSpectra::~SharedSpectra() {
+    if (!header) return;
+    if (stripe >= 0) {
+        fold(stripe);
+        header->owners[stripe].store(0, std::memory_order_release);
+    }
+    munmap(header, length);
+}
+
+bool SharedSpectra::remove(const std::string &name) {
+    return shm_unlink(shmName(name).c_str()) == 0;
+}
+
+void SharedSpectra::fold(int s) {
+    auto values = common + size_t(1 + s) * header->nValues;
+    header->folders[s].store(getpid());
+    header->generation.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_release); //before the sums change
+    for (uint32_t i = 0; i < header->nValues; ++i) {
+        if (values[i].load(std::memory_order_relaxed) == 0) continue;
+        double w = values[i].exchange(0, std::memory_order_relaxed); //out of the stripe before it is added
+        atomicAdd(common[i], w);
+    }
+    header->generation.fetch_add(1);
+    header->folders[s].store(0);
+}
+
+bool SharedSpectra::folding() const {
+    for (int s = 0; s < kMaxSharedStripes; ++s) {
+        int32_t folder = header->folders[s].load(std::memory_order_acquire);
+        if (folder == 0) continue;
+        if (kill(folder, 0) == 0 || errno != ESRCH) return true;
+        header->folders[s].compare_exchange_strong(folder, 0); //died while folding, would be waited for forever
+    }
+    return false;
+}
+
+//==========================================================================
+// Filling. The bins are found as in JetSpectra::fill, the values are added to the own stripe.
+
+void SharedSpectra::add(size_t i, double w) {
+    if (own) own[i].store(own[i].load(std::memory_order_relaxed) + w, std::memory_order_relaxed);
+    else atomicAdd(common[i], w);
+}
+
+void SharedSpectra::fillSpectrum(size_t offset, const Spectrum &spectrum, double x, double w) {
+    size_t nBins = spectrum.axis.n() + 2;
+    int bin = spectrum.axis.find(x);
+    add(offset + bin, w);
+    add(offset + nBins + bin, w * w);
+    add(offset + 2 * nBins, 1);
+}
+
+void SharedSpectra::fill(size_t definition, const fastjet::PseudoJet &jet, double w) {
+    if (!header || definition >= names.size()) return;
+    size_t offset = definition * perDefinition;
+    fillSpectrum(offset, binning.pT, jet.pt(), w);
+    fillSpectrum(offset + pTsize, binning.mass, jet.m(), w);
+    fillSpectrum(offset + pTsize + massSize, binning.multiplicity, JetSpectra::constituents(jet), w);
+}
+
+//==========================================================================
+// Reading. A stripe being folded would be counted twice or not at all, such reads are repeated.
+// A fold left half done by a dead process is read as it is: every value is in the stripe or in the
+// common sums, except at most the one taken out of the stripe when the process died, which is lost.
+
+std::vector<JetSpectra> SharedSpectra::read() const {
+    std::vector<JetSpectra> result(names.size());
+    if (!header) return result;
+    std::vector<double> sums(header->nValues);
+    for (;;) {
+        uint64_t generation = header->generation.load(std::memory_order_acquire);
+        if (!folding()) {
+            std::fill(sums.begin(), sums.end(), 0.);
+            for (int s = 0; s <= kMaxSharedStripes; ++s) {
+                auto values = common + size_t(s) * header->nValues;
+                for (uint32_t i = 0; i < header->nValues; ++i) sums[i] += values[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (!folding() && header->generation.load() == generation) break;
+        }
+        usleep(100);
+    }
+    const double *in = sums.data();
+    for (auto &spectra: result) spectra.unpack(in);
+    return result;
+}
@@ -0,0 +1,76 @@
+//
+// Jet spectra of every jet definition in a named POSIX shared memory segment, so all processes of a
+// node which fill it accumulate into one live result and nothing has to be merged afterwards.
+// Every process fills a stripe of its own, readers sum the stripes. Standard library and POSIX only,
+// apart from JetSpectra for the binning.
+//
+
+#ifndef PYTHIAPROJECT_SHAREDSPECTRA_H
+#define PYTHIAPROJECT_SHAREDSPECTRA_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "fastjet/PseudoJet.hh"
+
+#include "spectra.h"
+
+
+
+// Memory layout: SharedSpectraHeader, then the common sums and kMaxSharedStripes stripes, each
+// nValues doubles laid out as JetSpectra::pack() of every definition. A stripe belongs to the
+// process whose pid is in its owner; only that process writes it, plain stores without contention.
+// On exit a process adds its stripe to the common sums (atomic adds) and frees it, the stripe of a
+// process which died is folded in the same way by the next process taking it. When every stripe
+// is taken, a process adds to the common sums directly. A fold cut short by the death of its
+// process is finished by the next one taking the stripe, readers do not wait for it.
+const int kMaxSharedStripes = 64;
+const int kMaxSharedDefinitions = 16;
+
+struct SharedSpectraHeader {
+    char magic[8];
+    uint64_t layout; //hash of the definitions and the binning, every process has to agree
+    uint32_t nValues, nDefinitions;
+    char definitions[kMaxSharedDefinitions][32];
+    std::atomic<uint64_t> generation; //incremented before and after every fold, readers retry on a change
+    std::atomic<int32_t> owners[kMaxSharedStripes]; //pid, 0 - free
+    std::atomic<int32_t> folders[kMaxSharedStripes]; //pid of the process folding the stripe, 0 - none
+};
+
+class SharedSpectra {
+public:
+    //creates the segment or joins it and takes a stripe
+    SharedSpectra(const std::string &name, const std::vector<std::string> &definitions);
+    explicit SharedSpectra(const std::string &name); //only reads, takes no stripe
+    ~SharedSpectra();
+    SharedSpectra(const SharedSpectra &) = delete;
+    SharedSpectra &operator=(const SharedSpectra &) = delete;
+
+    bool good() const { return header != nullptr; }
+    bool striped() const { return own != nullptr; }
+    const std::vector<std::string> &definitions() const { return names; }
+
+    void fill(size_t definition, const fastjet::PseudoJet &jet, double w = 1);
+    std::vector<JetSpectra> read() const; //sums of all processes so far, by definition
+
+    static bool remove(const std::string &name); //shm_unlink, the processes attached keep their mapping
+
+private:
+    void attach(const std::string &name, bool create, const std::vector<std::string> &definitions);
+    void add(size_t i, double w);
+    void fillSpectrum(size_t offset, const Spectrum &binning, double x, double w);
+    void fold(int stripe); //adds the stripe to the common sums and zeroes it
+    bool folding() const; //by a process alive
+
+    SharedSpectraHeader *header = nullptr;
+    size_t length = 0;
+    std::atomic<double> *common = nullptr, *own = nullptr;
+    int stripe = -1;
+    std::vector<std::string> names;
+    JetSpectra binning;
+    size_t pTsize = 0, massSize = 0, perDefinition = 0; //values of pT, mass and of one definition
+};
+
+#endif //PYTHIAPROJECT_SHAREDSPECTRA_H
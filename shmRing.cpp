@@ -0,0 +1,164 @@
+#include "shmRing.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+
+static const char ringMagic[8] = {'P', 'P', 'S', 'H', 'M', 'R', 'N', 'G'};
+
+static std::string shmName(const std::string &name) { return name[0] == '/' ? name : "/" + name; }
+
+static RingSlot *ringSlot(RingHeader *header, uint64_t record) {
+    return reinterpret_cast<RingSlot *>(reinterpret_cast<char *>(header + 1) +
+                                        (record % header->nSlots) * header->slotStride);
+}
+
+//==========================================================================
+// Producer. Only it advances head and writes slots, so head needs no read-modify-write.
+
+ShmRingProducer::ShmRingProducer(const std::string &name, uint32_t nSlots, uint32_t slotSize,
+                                 RingPolicy policy) : name(shmName(name)) {
+    uint32_t slotStride = (sizeof(RingSlot) + slotSize + 63) / 64 * 64;
+    length = sizeof(RingHeader) + size_t(nSlots) * slotStride;
+    shm_unlink(this->name.c_str()); //a ring left over by a crashed run
+    int fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, length) != 0) {
+        printf("Cannot create shared memory ring %s: %s\n", this->name.c_str(), strerror(errno));
+        if (fd >= 0) close(fd);
+        return;
+    }
+    void *address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        printf("Cannot map shared memory ring %s\n", this->name.c_str());
+        return;
+    }
+    header = static_cast<RingHeader *>(address); //zero filled by ftruncate
+    header->nSlots = nSlots;
+    header->slotSize = slotSize;
+    header->slotStride = slotStride;
+    header->policy = policy;
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, ringMagic, 8);
+}
+
+ShmRingProducer::~ShmRingProducer() {
+    if (!header) return;
+    header->closed.store(1, std::memory_order_release);
+    munmap(header, length);
+    shm_unlink(name.c_str()); //attached consumers keep their mapping and drain it
+}
+
+void ShmRingProducer::waitForConsumers(uint64_t record) {
+    for (int nWaits = 0;; ++nWaits) {
+        bool full = false;
+        for (auto &consumer: header->consumers) {
+            int32_t pid = consumer.pid.load(std::memory_order_acquire);
+            if (pid == 0) continue;
+            if (nWaits % 1000 == 999 && kill(pid, 0) != 0 && errno == ESRCH) { //died without detaching
+                consumer.pid.compare_exchange_strong(pid, 0);
+                continue;
+            }
+            full |= record - consumer.tail.load(std::memory_order_acquire) >= header->nSlots;
+        }
+        if (!full) return;
+        usleep(50);
+    }
+}
+
+bool ShmRingProducer::publish(const void *data, uint32_t size) {
+    if (!header || size > header->slotSize) return false;
+    uint64_t record = header->head.load(std::memory_order_relaxed);
+    if (header->policy == kBackpressure) waitForConsumers(record);
+
+    RingSlot *slot = ringSlot(header, record);
+    slot->sequence.store(2 * record + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); //odd before the data changes
+    slot->size = size;
+    memcpy(reinterpret_cast<char *>(slot + 1), data, size);
+    slot->sequence.store(2 * record + 2, std::memory_order_release);
+    header->head.store(record + 1, std::memory_order_release);
+    return true;
+}
+
+//==========================================================================
+// Consumers. Under kDropOldest a slot may be rewritten while it is copied; the sequence read before
+// and after the copy tells, and the record is then counted as dropped.
+
+ShmRingConsumer::ShmRingConsumer(const std::string &name) {
+    int fd = shm_open(shmName(name).c_str(), O_RDWR, 0);
+    struct stat info{};
+    if (fd < 0 || fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(RingHeader)) {
+        printf("Cannot open shared memory ring %s, is the producer running?\n", name.c_str());
+        if (fd >= 0) close(fd);
+        return;
+    }
+    length = info.st_size;
+    void *address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) return;
+    header = static_cast<RingHeader *>(address);
+    if (memcmp(header->magic, ringMagic, 8) != 0) {
+        printf("%s is not a shared memory ring\n", name.c_str());
+        munmap(header, length);
+        header = nullptr;
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    for (int i = 0; i < kMaxRingConsumers && slot < 0; ++i) {
+        auto &consumer = header->consumers[i];
+        int32_t free = 0;
+        if (consumer.pid.compare_exchange_strong(free, getpid())) slot = i;
+    }
+    if (slot < 0) {
+        printf("Shared memory ring %s has already %d consumers\n", name.c_str(), kMaxRingConsumers);
+        return;
+    }
+    position = header->head.load(std::memory_order_acquire); //the producer may wait on a stale tail till here
+    header->consumers[slot].tail.store(position, std::memory_order_release);
+}
+
+ShmRingConsumer::~ShmRingConsumer() {
+    if (!header) return;
+    if (slot >= 0) header->consumers[slot].pid.store(0, std::memory_order_release);
+    munmap(header, length);
+}
+
+ShmRingConsumer::Result ShmRingConsumer::next(std::vector<char> &record) {
+    if (!good()) return kClosed;
+    for (;;) {
+        bool closed = header->closed.load(std::memory_order_acquire);
+        uint64_t head = header->head.load(std::memory_order_acquire);
+        if (position >= head) return closed ? kClosed : kEmpty;
+        if (head - position > header->nSlots) { //overwritten already
+            nDropped += head - position - header->nSlots;
+            position = head - header->nSlots;
+        }
+
+        RingSlot *ring = ringSlot(header, position);
+        uint64_t expected = 2 * position + 2;
+        uint64_t before = ring->sequence.load(std::memory_order_acquire);
+        if (before == expected) {
+            uint32_t size = std::min(ring->size, header->slotSize);
+            record.resize(size);
+            memcpy(record.data(), ring + 1, size);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (ring->sequence.load(std::memory_order_relaxed) == expected) {
+                header->consumers[slot].tail.store(++position, std::memory_order_release);
+                return kRecord;
+            }
+        }
+        ++nDropped; //the producer has lapped this record
+        ++position;
+    }
+}
@@ -0,0 +1,103 @@
+//
+// Single-producer / multi-consumer ring buffer in POSIX shared memory (shm_open + mmap), so other
+// processes on the node read events and jets as they are generated. Standard library and POSIX only.
+//
+
+#ifndef PYTHIAPROJECT_SHMRING_H
+#define PYTHIAPROJECT_SHMRING_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+
+// kBackpressure: the producer waits for the slowest attached consumer, nothing is lost.
+// kDropOldest:   the producer never waits, a consumer which falls behind by more than the ring
+//                loses the oldest records and sees them counted in dropped().
+enum RingPolicy : uint32_t { kBackpressure = 0, kDropOldest = 1 };
+
+// Records published by main.cpp: RingEvent, then nParticles RingParticles, then nJets RingJets.
+struct RingEvent {
+    int32_t event;
+    uint32_t nParticles, nJets, nDefinitions;
+    double weight;
+};
+
+struct RingParticle {
+    float px, py, pz, e;
+    int32_t id;
+};
+
+struct RingJet {
+    float pt, y, phi, m;
+    uint16_t definition, nConstituents;
+};
+
+// Memory layout of the segment: RingHeader, then nSlots slots of slotStride bytes, each a RingSlot
+// followed by its data. A slot's sequence is odd while it is written and 2 * record + 2 after.
+const int kMaxRingConsumers = 16;
+
+struct RingConsumerSlot {
+    std::atomic<uint64_t> tail; //next record the consumer reads
+    std::atomic<int32_t> pid;   //0 - free
+    uint32_t pad;
+};
+
+struct RingHeader {
+    char magic[8];
+    uint32_t nSlots, slotSize, slotStride, policy;
+    std::atomic<uint64_t> head; //next record to be written
+    std::atomic<uint32_t> closed;
+    uint32_t pad;
+    RingConsumerSlot consumers[kMaxRingConsumers];
+};
+
+struct RingSlot {
+    std::atomic<uint64_t> sequence;
+    uint32_t size, pad;
+};
+
+class ShmRingProducer {
+public:
+    ShmRingProducer(const std::string &name, uint32_t nSlots, uint32_t slotSize, RingPolicy policy);
+    ~ShmRingProducer(); //marks the ring closed and removes its name
+    ShmRingProducer(const ShmRingProducer &) = delete;
+    ShmRingProducer &operator=(const ShmRingProducer &) = delete;
+
+    bool good() const { return header != nullptr; }
+    uint32_t slotSize() const { return header ? header->slotSize : 0; }
+    bool publish(const void *data, uint32_t size); //false if it does not fit into a slot
+    uint64_t published() const { return header ? header->head.load() : 0; }
+
+private:
+    void waitForConsumers(uint64_t record);
+
+    std::string name;
+    RingHeader *header = nullptr;
+    size_t length = 0;
+};
+
+class ShmRingConsumer {
+public:
+    enum Result { kRecord, kEmpty, kClosed };
+
+    explicit ShmRingConsumer(const std::string &name); //starts with the next record published
+    ~ShmRingConsumer();
+    ShmRingConsumer(const ShmRingConsumer &) = delete;
+    ShmRingConsumer &operator=(const ShmRingConsumer &) = delete;
+
+    bool good() const { return header != nullptr && slot >= 0; }
+    Result next(std::vector<char> &record); //copies the record out of the ring
+    uint64_t dropped() const { return nDropped; }
+
+private:
+    RingHeader *header = nullptr;
+    size_t length = 0;
+    int slot = -1;
+    uint64_t position = 0;
+    uint64_t nDropped = 0;
+};
+
+#endif //PYTHIAPROJECT_SHMRING_H
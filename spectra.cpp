@@ -0,0 +1,157 @@
+#include "spectra.h"
+
+#include <cmath>
+
+#include "drawF.h"
+#include "graphicsPool.h"
+
+
+
+FastAxis::FastAxis(Type type, const std::vector<double> &edges)
+        : type(type), nBins(edges.size() - 1), offset(0), scale(0), edgeTable(edges) {}
+
+FastAxis FastAxis::uniform(int n, double min, double max) {
+    std::vector<double> edges;
+    for (int i = 0; i <= n; ++i) edges.push_back(min + (max - min) * i / n);
+    FastAxis axis(kUniform, edges);
+    axis.offset = min;
+    axis.scale = n / (max - min);
+    return axis;
+}
+
+FastAxis FastAxis::log(int n, double min, double max) {
+    std::vector<double> edges;
+    for (int i = 0; i <= n; ++i) edges.push_back(min * std::pow(max / min, double(i) / n));
+    FastAxis axis(kLog, edges);
+    axis.offset = std::log(min);
+    axis.scale = n / std::log(max / min);
+    return axis;
+}
+
+FastAxis FastAxis::variable(const std::vector<double> &edges) {
+    return FastAxis(kVariable, edges);
+}
+
+int FastAxis::find(double x) const {
+    if (type == kVariable) return findVariable(x);
+    if (type == kLog && !(x > 0)) return 0;
+
+    double u = ((type == kLog ? std::log(x) : x) - offset) * scale;
+    if (!(u >= 0)) return 0;
+    if (u >= nBins) return nBins + 1;
+    int bin = 1 + int(u);
+    //rounding of u can be one bin off right at an edge
+    if (x < edgeTable[bin - 1]) --bin;
+    else if (x >= edgeTable[bin]) ++bin;
+    return bin;
+}
+
+//==========================================================================
+// Number of edges <= x, which is the bin number. The loop runs log2(n) times
+// whatever x is and the comparison only selects the next base (cmov).
+
+int FastAxis::findVariable(double x) const {
+    const double *first = edgeTable.data(), *base = first;
+    size_t n = edgeTable.size();
+    while (n > 1) {
+        size_t half = n / 2;
+        base = (base[half] <= x) ? base + half : base;
+        n -= half;
+    }
+    return int(base - first) + (*base <= x);
+}
+
+//==========================================================================
+// Spectra.
+
+void Spectrum::add(const Spectrum &other) {
+    for (size_t i = 0; i < sumW.size(); ++i) {
+        sumW[i] += other.sumW[i];
+        sumW2[i] += other.sumW2[i];
+    }
+    entries += other.entries;
+}
+
+void Spectrum::pack(std::vector<double> &out) const {
+    out.insert(out.end(), sumW.begin(), sumW.end());
+    out.insert(out.end(), sumW2.begin(), sumW2.end());
+    out.push_back(entries);
+}
+
+void Spectrum::unpack(const double *&in) {
+    sumW.assign(in, in + sumW.size()), in += sumW.size();
+    sumW2.assign(in, in + sumW2.size()), in += sumW2.size();
+    entries = std::lround(*in++);
+}
+
+TH1D *Spectrum::toTH1D(const char *name, const char *title) const {
+    auto result = new TH1D(name, title, axis.n(), axis.edges().data());
+    result->SetDirectory(nullptr);
+    for (int i = 0; i <= axis.n() + 1; ++i) {
+        result->SetBinContent(i, sumW[i]);
+        result->SetBinError(i, std::sqrt(sumW2[i]));
+    }
+    result->SetEntries(entries);
+    return result;
+}
+
+JetSpectra::JetSpectra()
+        : pT(FastAxis::log(40, 5, 1000)),
+          mass(FastAxis::variable({0, 1, 2, 3, 4, 5, 6, 8, 10, 12, 15, 20, 25, 30, 40, 50, 70, 100})),
+          multiplicity(FastAxis::uniform(60, -0.5, 59.5)) {}
+
+int JetSpectra::constituents(const fastjet::PseudoJet &jet) {
+    int n = 0;
+    for (auto &c: jet.constituents()) n += c.pt() > 1e-50;
+    return n;
+}
+
+void JetSpectra::fill(const fastjet::PseudoJet &jet, double w) {
+    pT.fill(jet.pt(), w);
+    mass.fill(jet.m(), w);
+    multiplicity.fill(constituents(jet), w);
+}
+
+void JetSpectra::add(const JetSpectra &other) {
+    pT.add(other.pT);
+    mass.add(other.mass);
+    multiplicity.add(other.multiplicity);
+}
+
+void JetSpectra::pack(std::vector<double> &out) const {
+    pT.pack(out);
+    mass.pack(out);
+    multiplicity.pack(out);
+}
+
+void JetSpectra::unpack(const double *&in) {
+    pT.unpack(in);
+    mass.unpack(in);
+    multiplicity.unpack(in);
+}
+
+//==========================================================================
+// Three pages in one pdf: pT, mass and multiplicity.
+
+void drawJetSpectra(TCanvas *canvas, const JetSpectra &spectra, const TString &description,
+                    const TString &jetName, const TString &fileName) {
+    const Spectrum *pages[] = {&spectra.pT, &spectra.mass, &spectra.multiplicity};
+    const char *titles[] = {";Jet #it{p}_{T} [GeV];Jets", ";Jet mass [GeV];Jets", ";Constituents;Jets"};
+    const char *suffixes[] = {"(", "", ")"};
+
+    canvas->cd();
+    canvas->SetLogy();
+    for (int i = 0; i < 3; ++i) {
+        newPage(canvas);
+        canvas->SetLogx(i == 0);
+        auto h = pages[i]->toTH1D("", titles[i]);
+        h->SetLineColor(kBlue);
+        h->Draw("hist e");
+        drawText(0.06, 0.96, description);
+        drawText(0.98, 0.96, jetName, 31);
+        canvas->Print(fileName + suffixes[i]);
+        delete h;
+    }
+    canvas->SetLogx(0);
+    canvas->SetLogy(0);
+}
@@ -0,0 +1,78 @@
+//
+// 1D spectra with constant-time bin lookup, filled many times per event and turned into TH1D only for drawing.
+//
+
+#ifndef PYTHIAPROJECT_SPECTRA_H
+#define PYTHIAPROJECT_SPECTRA_H
+
+#include <vector>
+
+#include "TCanvas.h"
+#include "TString.h"
+#include "TH1D.h"
+#include "fastjet/PseudoJet.hh"
+
+
+
+// Bins numbered as in ROOT: 1..n, 0 and n + 1 are under- and overflow.
+// Uniform and logarithmic axes compute the bin, arbitrary edges use a binary search without
+// data-dependent branches. The computed bin is corrected against the edge table, so a value
+// always lands in the same bin as with TAxis::FindBin.
+class FastAxis {
+public:
+    enum Type { kUniform, kLog, kVariable };
+
+    static FastAxis uniform(int n, double min, double max);
+    static FastAxis log(int n, double min, double max);
+    static FastAxis variable(const std::vector<double> &edges);
+
+    int find(double x) const;
+    int n() const { return nBins; }
+    const std::vector<double> &edges() const { return edgeTable; } //n + 1 edges
+
+private:
+    FastAxis(Type type, const std::vector<double> &edges);
+    int findVariable(double x) const;
+
+    Type type;
+    int nBins;
+    double offset, scale; //bin = 1 + (x - offset) * scale, x is log(x) for kLog
+    std::vector<double> edgeTable;
+};
+
+class Spectrum {
+public:
+    explicit Spectrum(const FastAxis &axis) : axis(axis), sumW(axis.n() + 2), sumW2(axis.n() + 2) {}
+
+    void fill(double x, double w = 1) {
+        int bin = axis.find(x);
+        sumW[bin] += w;
+        sumW2[bin] += w * w;
+        ++entries;
+    }
+    void add(const Spectrum &other);
+    void pack(std::vector<double> &out) const; //sumW, sumW2 and entries appended, e.g. to be summed over processes
+    void unpack(const double *&in);            //the inverse, in is moved past the values
+    TH1D *toTH1D(const char *name, const char *title) const; //don't forget to free the memory
+
+    FastAxis axis;
+    std::vector<double> sumW, sumW2;
+    long entries = 0;
+};
+
+// Spectra of the jets of one jet definition.
+struct JetSpectra {
+    JetSpectra();
+    void fill(const fastjet::PseudoJet &jet, double w = 1);
+    void add(const JetSpectra &other);
+    static int constituents(const fastjet::PseudoJet &jet); //ghosts are not counted
+    void pack(std::vector<double> &out) const;
+    void unpack(const double *&in);
+
+    Spectrum pT, mass, multiplicity; //multiplicity of constituents, ghosts are not counted
+};
+
+void drawJetSpectra(TCanvas *canvas, const JetSpectra &spectra, const TString &description,
+                    const TString &jetName, const TString &fileName);
+
+#endif //PYTHIAPROJECT_SPECTRA_H
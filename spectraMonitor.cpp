@@ -0,0 +1,91 @@
+//
+// Reads the jet spectra which the processes of a node add to in shared memory (see Shared:name) and
+// prints the jets, their summed weight and mean pT per jet definition, every second while --seconds
+// last, once by default. --out also draws the spectra as main.cpp does, --remove deletes the
+// segment afterwards, so the next run starts from zero.
+//
+//   spectraMonitor <name> [--seconds n] [--out dir] [--remove]
+//
+// Built from spectraMonitor.cpp, sharedSpectra.cpp, spectra.cpp, drawF.cpp and graphicsPool.cpp with
+// the same flags as main.cpp.
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "TCanvas.h"
+#include "TString.h"
+#include "TSystem.h"
+
+#include "drawF.h"
+#include "graphicsPool.h"
+#include "sharedSpectra.h"
+
+
+
+static void print(const SharedSpectra &shared) {
+    auto spectra = shared.read();
+    for (size_t d = 0; d < spectra.size(); ++d) {
+        auto &pT = spectra[d].pT;
+        auto &edges = pT.axis.edges();
+        double sumW = 0, sumPt = 0, inRange = 0;
+        for (int i = 0; i <= pT.axis.n() + 1; ++i) sumW += pT.sumW[i];
+        for (int i = 1; i <= pT.axis.n(); ++i) {
+            sumPt += pT.sumW[i] * std::sqrt(edges[i - 1] * edges[i]); //log bins
+            inRange += pT.sumW[i];
+        }
+        printf("  %-12s %10ld jets, sum of weights %-10.4g mean pT %7.2f GeV\n", shared.definitions()[d].c_str(),
+               pT.entries, sumW, inRange > 0 ? sumPt / inRange : 0.);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <name> [--seconds n] [--out dir] [--remove]\n", argv[0]);
+        return 1;
+    }
+    double seconds = 0;
+    TString out;
+    bool remove = false;
+    for (int i = 2; i < argc; ++i) {
+        if (!strcmp(argv[i], "--remove")) remove = true;
+        else if (i + 1 < argc && !strcmp(argv[i], "--seconds")) seconds = atof(argv[++i]);
+        else if (i + 1 < argc && !strcmp(argv[i], "--out")) out = argv[++i];
+    }
+
+    {
+        SharedSpectra shared(argv[1]);
+        if (!shared.good()) return 1;
+        auto start = std::chrono::steady_clock::now();
+        for (;;) {
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            printf("%s after %.0f s:\n", argv[1], elapsed);
+            print(shared);
+            if (elapsed + 1 > seconds) break;
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+
+        if (!out.IsNull()) {
+            gSystem->mkdir(out, true);
+            setUpRootStyle();
+            auto canvas = new TCanvas();
+            canvas->SetMargin(0.1, 0.04, 0.1, 0.06);
+            auto spectra = shared.read();
+            TString description = Form("Shared spectra %s", argv[1]);
+            for (size_t d = 0; d < spectra.size(); ++d) {
+                TString name = shared.definitions()[d].c_str();
+                drawJetSpectra(canvas, spectra[d], description, name, out + "/[" + description + "] " + name + ".pdf");
+            }
+            printf("Produced %s\n", out.Data());
+            releaseGraphicsPool(canvas);
+            delete canvas;
+        }
+    }
+
+    if (remove) printf("%s %s\n", SharedSpectra::remove(argv[1]) ? "Removed" : "Cannot remove", argv[1]);
+    return 0;
+}
@@ -0,0 +1,303 @@
+#include "stageTimers.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+
+
+std::atomic<uint64_t> StageTimers::nextInstance{1};
+
+//==========================================================================
+// Log-linear buckets: below kSub one per nanosecond, above kSub per power of two, the leading
+// kSubBits + 1 bits of the value select the bucket.
+
+int LatencyHistogram::bucket(uint64_t ns) {
+    if (ns < uint64_t(kSub)) return int(ns);
+    int exponent = 63 - __builtin_clzll(ns); //at least kSubBits
+    return (exponent - kSubBits + 1) * kSub + int(ns >> (exponent - kSubBits)) - kSub;
+}
+
+double LatencyHistogram::middle(int bucket) {
+    if (bucket < kSub) return bucket;
+    int exponent = bucket / kSub + kSubBits - 1, sub = bucket % kSub;
+    double width = std::ldexp(1., exponent - kSubBits);
+    return (kSub + sub) * width + width / 2;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    if (counts.empty()) counts.assign(kBuckets, 0);
+    ++counts[bucket(ns)];
+    ++n;
+    sum += ns;
+    largest = std::max(largest, ns);
+}
+
+void LatencyHistogram::add(const LatencyHistogram &other) {
+    if (other.counts.empty()) return;
+    if (counts.empty()) counts.assign(kBuckets, 0);
+    for (int i = 0; i < kBuckets; ++i) counts[i] += other.counts[i];
+    n += other.n;
+    sum += other.sum;
+    largest = std::max(largest, other.largest);
+}
+
+double LatencyHistogram::percentile(double p) const {
+    if (n == 0) return 0;
+    uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(p / 100 * n))), seen = 0;
+    for (int i = 0; i < kBuckets; ++i)
+        if ((seen += counts[i]) >= rank) return std::min(middle(i), double(largest));
+    return largest;
+}
+
+//==========================================================================
+// Every thread finds its histograms through a thread-local pointer, looked up under the mutex only
+// the first time it records (or when it records into other StageTimers).
+
+int StageTimers::stage(const std::string &name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto known = std::find(names.begin(), names.end(), name);
+    if (known != names.end()) return known - names.begin();
+    names.push_back(name);
+    return names.size() - 1;
+}
+
+StageTimers::ThreadRecords &StageTimers::local() {
+    thread_local uint64_t cachedInstance = 0;
+    thread_local ThreadRecords *cached = nullptr;
+    if (cachedInstance != instance) {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.emplace_back(new ThreadRecords());
+        cached = threads.back().get();
+        cachedInstance = instance;
+    }
+    return *cached;
+}
+
+void StageTimers::record(int stage, Clock::time_point start, Clock::time_point end, const uint64_t *startCounters) {
+    if (!on) return;
+    auto &records = local();
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    if (size_t(stage) >= records.stages.size()) records.stages.resize(stage + 1);
+    records.stages[stage].record(ns);
+    uint64_t endCounters[kHardwareCounters];
+    if (startCounters && readCounters(endCounters)) {
+        if (size_t(stage) >= records.counters.size()) records.counters.resize(stage + 1);
+        auto &sums = records.counters[stage];
+        ++sums.calls;
+        for (int c = 0; c < kHardwareCounters; ++c) sums.values[c] += endCounters[c] - startCounters[c];
+    }
+    if (!maxRecords) return;
+    if (records.trace.size() == maxRecords) {
+        ++records.nDropped;
+        return;
+    }
+    uint64_t since = std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin).count();
+    records.trace.push_back(TraceRecord{stage, records.event, since, ns});
+}
+
+void StageTimers::record(int stage, uint64_t ns) {
+    if (!on) return;
+    auto end = Clock::now();
+    record(stage, end - std::chrono::nanoseconds(ns), end);
+}
+
+void StageTimers::trace(size_t maxRecords) {
+    this->maxRecords = maxRecords;
+    on = on || maxRecords > 0;
+}
+
+void StageTimers::report() const {
+    if (!on) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<LatencyHistogram> merged(names.size());
+    for (auto &thread: threads)
+        for (size_t s = 0; s < thread->stages.size() && s < merged.size(); ++s) merged[s].add(thread->stages[s]);
+
+    size_t width = 5;
+    for (auto &name: names) width = std::max(width, name.size());
+    printf("Time per stage (%zu threads):\n", threads.size());
+    printf("  %-*s %10s %11s %11s %11s %11s %11s\n", int(width), "stage", "calls", "total s", "mean ms", "p50 ms",
+           "p99 ms", "max ms");
+    for (size_t s = 0; s < names.size(); ++s) {
+        auto &h = merged[s];
+        if (h.count() == 0) continue;
+        printf("  %-*s %10llu %11.3f %11.4f %11.4f %11.4f %11.4f\n", int(width), names[s].c_str(),
+               (unsigned long long) h.count(), h.total() * 1e-9, h.total() * 1e-6 / h.count(),
+               h.percentile(50) * 1e-6, h.percentile(99) * 1e-6, h.max() * 1e-6);
+    }
+    printf("\n");
+}
+
+//==========================================================================
+// Chrome trace-event JSON: a complete event ("ph":"X") per stage with microsecond timestamps, the
+// event number as an argument, and metadata events naming the process and the threads.
+
+static std::string jsonString(const std::string &s) {
+    std::string quoted = "\"";
+    for (char c: s) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        if ((unsigned char) c >= 0x20) quoted += c;
+    }
+    return quoted + "\"";
+}
+
+bool StageTimers::writeTrace(const std::string &file) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    FILE *out = fopen(file.c_str(), "w");
+    if (!out) {
+        printf("Cannot write the trace %s\n", file.c_str());
+        return false;
+    }
+    std::vector<std::string> quoted;
+    for (auto &name: names) quoted.push_back(jsonString(name));
+    int pid = getpid();
+    uint64_t nRecords = 0, nDropped = 0;
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"main %d\"}}",
+            pid, pid);
+    for (size_t t = 0; t < threads.size(); ++t) {
+        auto &thread = *threads[t];
+        std::string name = thread.name ? thread.name : "thread";
+        fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%zu,\"args\":{\"name\":%s}}",
+                pid, t, jsonString(name + " " + std::to_string(t)).c_str());
+        for (auto &record: thread.trace) {
+            fprintf(out, ",\n{\"name\":%s,\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%zu",
+                    quoted[record.stage].c_str(), record.start * 1e-3, record.duration * 1e-3, pid, t);
+            if (record.event >= 0) fprintf(out, ",\"args\":{\"event\":%lld}", (long long) record.event);
+            fputc('}', out);
+        }
+        nRecords += thread.trace.size();
+        nDropped += thread.nDropped;
+    }
+    fprintf(out, "\n]}\n");
+    bool ok = fclose(out) == 0;
+    printf("Traced %llu stages in %s%s", (unsigned long long) nRecords, file.c_str(), ok ? "" : " (write failed)");
+    if (nDropped) printf(", %llu more did not fit", (unsigned long long) nDropped);
+    printf("\n\n");
+    return ok;
+}
+
+//==========================================================================
+// Hardware counters: a group per thread, user space only, which perf_event_paranoid 2 (the usual
+// default) allows for the own threads. Counters the CPU or the hypervisor do not offer are left
+// out of the group, without any the stages are only timed.
+
+static const char *counterNames[kHardwareCounters] = {"cycles", "instructions", "cache misses", "branch misses"};
+
+StageTimers::ThreadRecords::~ThreadRecords() {
+    for (int fd: fds)
+        if (fd >= 0) close(fd);
+}
+
+void StageTimers::countHardware() {
+    countersOn = true;
+    on = true;
+}
+
+void StageTimers::openCounters(ThreadRecords &records) {
+    records.opened = true;
+    std::string missing;
+    int error = 0;
+#ifdef __linux__
+    static const uint64_t configs[kHardwareCounters] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    int nSlots = 0;
+    for (int c = 0; c < kHardwareCounters; ++c) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[c];
+        attr.disabled = records.leader < 0; //the whole group is enabled at once below
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, records.leader, 0); //this thread, on any CPU
+        if (fd < 0) {
+            error = errno;
+            missing += missing.empty() ? counterNames[c] : std::string(", ") + counterNames[c];
+            continue;
+        }
+        if (records.leader < 0) records.leader = fd;
+        records.fds[c] = fd;
+        records.slots[c] = nSlots++;
+    }
+    if (records.leader >= 0) ioctl(records.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    error = ENOSYS;
+    missing = "all counters";
+#endif
+    if (missing.empty() || warned.exchange(true)) return;
+    const char *reason = error == EACCES || error == EPERM ? "not permitted, see kernel.perf_event_paranoid or "
+                                                             "the seccomp profile of the container"
+                         : error == ENOENT || error == EOPNOTSUPP || error == ENODEV
+                         ? "not offered by this CPU or virtual machine" : strerror(error);
+    printf("Hardware counters unavailable (%s): %s%s\n", missing.c_str(), reason,
+           records.leader < 0 ? ", the stages are only timed" : "");
+}
+
+bool StageTimers::readCounters(uint64_t *values) {
+    auto &records = local();
+    if (!records.opened) openCounters(records);
+    if (records.leader < 0) return false;
+    uint64_t data[3 + kHardwareCounters]; //nr, time enabled, time running, values
+    if (read(records.leader, data, sizeof(data)) < ssize_t(3 * sizeof(uint64_t))) return false;
+    records.enabled = data[1], records.running = data[2];
+    for (int c = 0; c < kHardwareCounters; ++c)
+        values[c] = records.slots[c] >= 0 && uint64_t(records.slots[c]) < data[0] ? data[3 + records.slots[c]] : 0;
+    return true;
+}
+
+void StageTimers::reportCounters(double nEvents, double nParticles) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<CounterSums> merged(names.size());
+    bool available[kHardwareCounters], any = false, multiplexed = false;
+    std::fill(available, available + kHardwareCounters, true);
+    for (auto &thread: threads) {
+        if (thread->leader < 0) continue;
+        any = true;
+        multiplexed = multiplexed || thread->running < thread->enabled;
+        for (int c = 0; c < kHardwareCounters; ++c) available[c] = available[c] && thread->slots[c] >= 0;
+        for (size_t s = 0; s < thread->counters.size() && s < merged.size(); ++s) {
+            merged[s].calls += thread->counters[s].calls;
+            for (int c = 0; c < kHardwareCounters; ++c) merged[s].values[c] += thread->counters[s].values[c];
+        }
+    }
+    if (!any) return;
+
+    //per event and per particle of the whole run, also for the stages which run once
+    auto column = [&](const CounterSums &sums, int c, double n) {
+        char text[16];
+        if (available[c] && n > 0) snprintf(text, sizeof(text), "%11.4g", sums.values[c] / n);
+        else snprintf(text, sizeof(text), "%11s", "-");
+        return std::string(text);
+    };
+    size_t width = 5;
+    for (auto &name: names) width = std::max(width, name.size());
+    printf("Hardware counters per stage, user space, %.0f events, %.0f particles (misses: cache, branch)%s:\n",
+           nEvents, nParticles, multiplexed ? ", multiplexed with other users of the counters" : "");
+    printf("  %-*s %9s %11s %6s %11s %11s %11s %11s %11s\n", int(width), "stage", "calls", "cycles/ev", "IPC",
+           "cache/ev", "branch/ev", "cycles/part", "cache/part", "branch/part");
+    for (size_t s = 0; s < names.size(); ++s) {
+        auto &sums = merged[s];
+        if (sums.calls == 0) continue;
+        char ipc[16];
+        if (available[0] && available[1] && sums.values[0] > 0)
+            snprintf(ipc, sizeof(ipc), "%6.2f", double(sums.values[1]) / sums.values[0]);
+        else snprintf(ipc, sizeof(ipc), "%6s", "-");
+        printf("  %-*s %9llu %s %s %s %s %s %s %s\n", int(width), names[s].c_str(), (unsigned long long) sums.calls,
+               column(sums, 0, nEvents).c_str(), ipc, column(sums, 2, nEvents).c_str(),
+               column(sums, 3, nEvents).c_str(), column(sums, 0, nParticles).c_str(),
+               column(sums, 2, nParticles).c_str(), column(sums, 3, nParticles).c_str());
+    }
+    printf("\n");
+}
@@ -0,0 +1,144 @@
+//
+// Wall-clock time per stage of the run (pythia.next(), clustering per jet definition, drawing, ...),
+// measured with steady_clock by scoped timers and kept in log-linear latency histograms, one set per
+// thread, so threads time their stages without sharing anything. report() merges them into a table
+// of calls, total, mean, p50, p99 and max per stage. With trace() every stage is also kept with its
+// start, duration and event number, in a buffer of the thread, and writeTrace() dumps the timeline
+// in the Chrome trace-event format for Perfetto (ui.perfetto.dev) or chrome://tracing. With
+// countHardware() the stages also read the perf_event_open counters of their thread (cycles,
+// instructions, cache and branch misses, user space only), where the kernel allows it.
+//
+
+#ifndef PYTHIAPROJECT_STAGETIMERS_H
+#define PYTHIAPROJECT_STAGETIMERS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+
+// Nanoseconds in buckets of 1/32 of a power of two (values below 32 exactly), at most about 3% off.
+class LatencyHistogram {
+public:
+    static const int kSubBits = 5, kSub = 1 << kSubBits, kBuckets = (64 - kSubBits + 1) * kSub;
+
+    void record(uint64_t ns);
+    void add(const LatencyHistogram &other);
+    uint64_t count() const { return n; }
+    uint64_t total() const { return sum; }
+    uint64_t max() const { return largest; }
+    double percentile(double p) const; //ns, the middle of the bucket
+
+private:
+    static int bucket(uint64_t ns);
+    static double middle(int bucket);
+
+    std::vector<uint64_t> counts; //allocated at the first record
+    uint64_t n = 0, sum = 0, largest = 0;
+};
+
+struct TraceRecord {
+    int32_t stage;
+    int64_t event;            //-1 - none
+    uint64_t start, duration; //ns, from the construction of the StageTimers
+};
+
+// Hardware counters of a thread, one perf_event_open group read at once.
+const int kHardwareCounters = 4; //cycles, instructions, cache misses, branch misses
+
+struct CounterSums {
+    uint64_t calls = 0;
+    uint64_t values[kHardwareCounters] = {};
+};
+
+class StageTimers {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit StageTimers(bool enabled = true) : on(enabled), origin(Clock::now()) {}
+
+    bool enabled() const { return on; }
+    int stage(const std::string &name); //the id of the stage, the same for the same name
+    //into the histograms and the trace of the calling thread, if enabled
+    void record(int stage, Clock::time_point start, Clock::time_point end, const uint64_t *startCounters = nullptr);
+    void record(int stage, uint64_t ns); //ended just now
+
+    //hardware counters around every stage, set before the threads record; without them (no permission,
+    //no PMU in a virtual machine, not Linux) the reason is printed once and the stages are only timed
+    void countHardware();
+    bool counting() const { return countersOn; }
+    bool readCounters(uint64_t *values); //of the calling thread, kHardwareCounters values
+
+    //timeline, at most maxRecords stages per thread (about 32 bytes each), set before the threads record
+    void trace(size_t maxRecords);
+    bool tracing() const { return maxRecords > 0; }
+    void setEvent(long event) { local().event = event; } //for the stages recorded next by this thread
+    void nameThread(const char *name) { local().name = name; } //a literal, e.g. "main", kept as a pointer
+
+    //after the threads which record are done
+    void report() const;
+    bool writeTrace(const std::string &file) const;
+    void reportCounters(double nEvents, double nParticles) const; //per stage, per event and per particle
+
+private:
+    struct ThreadRecords {
+        ~ThreadRecords();
+
+        std::vector<LatencyHistogram> stages;
+        std::vector<TraceRecord> trace;
+        long event = -1;
+        const char *name = nullptr;
+        uint64_t nDropped = 0; //above maxRecords
+        std::vector<CounterSums> counters;
+        int fds[kHardwareCounters] = {-1, -1, -1, -1};
+        int slots[kHardwareCounters] = {-1, -1, -1, -1}; //position in the group read, -1 - not counted
+        int leader = -1;
+        bool opened = false;
+        uint64_t enabled = 0, running = 0; //ns of the group, less running - multiplexed with other users
+    };
+
+    ThreadRecords &local();
+    void openCounters(ThreadRecords &records);
+
+    bool on, countersOn = false;
+    std::atomic<bool> warned{false};
+    Clock::time_point origin;
+    size_t maxRecords = 0;
+    std::vector<std::string> names;
+    mutable std::mutex mutex; //the names and the list of threads, not the records
+    std::vector<std::unique_ptr<ThreadRecords>> threads;
+    uint64_t instance = nextInstance++; //tells the thread-local caches of several StageTimers apart
+    static std::atomic<uint64_t> nextInstance;
+};
+
+// Records from construction to stop() or destruction, nothing when the timers are disabled.
+class ScopedTimer {
+public:
+    ScopedTimer(StageTimers &timers, int stage) : timers(timers.enabled() ? &timers : nullptr), stage(stage) {
+        if (this->timers && timers.counting()) counted = timers.readCounters(counters);
+        if (this->timers) start = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() { stop(); }
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    void stop() {
+        if (!timers) return;
+        timers->record(stage, start, std::chrono::steady_clock::now(), counted ? counters : nullptr);
+        timers = nullptr;
+    }
+
+private:
+    StageTimers *timers;
+    int stage;
+    bool counted = false;
+    uint64_t counters[kHardwareCounters];
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif //PYTHIAPROJECT_STAGETIMERS_H
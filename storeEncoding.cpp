@@ -0,0 +1,205 @@
+#include "storeEncoding.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+#include "eventStore.h"
+
+
+
+static uint64_t align8(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+PackedLayout::PackedLayout(uint32_t nEvents, uint32_t nParticles, const PackedCounts &counts) {
+    uint64_t at = align8(sizeof(BlockHeader) + sizeof(PackedCounts));
+    auto column = [&at](uint64_t bytes) {
+        uint64_t begin = at;
+        at = align8(at + bytes);
+        return begin;
+    };
+    number = column(4 * nEvents);
+    weight = column(8 * nEvents);
+    sigma = column(8 * nEvents);
+    pTHat = column(8 * nEvents);
+    offsets = column(4 * (nEvents + 1));
+    phiOffsets = column(4 * (nEvents + 1));
+    dictionaryId = column(4 * counts.nDictionary);
+    dictionaryM = column(4 * counts.nDictionary);
+    pT = column(2 * nParticles);
+    y = column(2 * nParticles);
+    entry = column(2 * nParticles);
+    charge = column(nParticles);
+    status = column(2 * nParticles);
+    phi = column(counts.phiBytes + 4); //padded, the decoder reads 4 bytes at a time
+    size = at;
+}
+
+float minPTprecision(float pTmin) {
+    return std::expm1(std::log(kMaxStoredPt / pTmin) / 65535);
+}
+
+static int nPhiCodes(const Quantization &q) {
+    return int(std::ceil(2 * M_PI / std::max(q.phiStep, 1e-5f)));
+}
+
+//==========================================================================
+// Encoding. Codes are computed from the four-momenta, so that pz and e come back as mT sinh y and
+// mT cosh y of the stored m, whatever mass the particle had in the event record.
+
+uint32_t packBlock(const BlockColumns &c, const Quantization &q, std::vector<char> &out) {
+    uint32_t nEv = c.nEvents, nP = c.nParticles;
+    double lnStep = std::log1p(q.pTprecision), phiStep = 2 * M_PI / nPhiCodes(q);
+    uint32_t nPhi = nPhiCodes(q);
+
+    std::vector<uint16_t> pT(nP), entry(nP);
+    std::vector<int16_t> y(nP);
+    std::vector<uint32_t> phi(nP);
+    std::vector<int32_t> dictionaryId;
+    std::vector<float> dictionaryM;
+    std::unordered_map<uint64_t, uint16_t> dictionary; //(id, mass code) -> entry
+    for (uint32_t k = 0; k < nEv; ++k) {
+        size_t nEntries = dictionaryId.size();
+        bool full = false;
+        for (uint32_t i = c.offsets[k]; i < c.offsets[k + 1] && !full; ++i) {
+            double px = c.px[i], py = c.py[i], pz = c.pz[i], e = c.e[i];
+            double pt = std::sqrt(px * px + py * py), m2 = e * e - px * px - py * py - pz * pz;
+            double rapidity = e > std::abs(pz) ? 0.5 * std::log((e + pz) / (e - pz)) : pz > 0 ? 1e9 : -1e9;
+            pT[i] = pt > q.pTmin ? std::min(65535., std::round(std::log(pt / q.pTmin) / lnStep)) : 0;
+            y[i] = std::max(-32767., std::min(32767., std::round(rapidity / q.yStep)));
+            phi[i] = uint32_t(std::round((std::atan2(py, px) + M_PI) / phiStep)) % nPhi;
+            uint32_t mCode = std::round(std::sqrt(std::max(m2, 0.)) / q.mStep);
+            uint64_t key = uint64_t(uint32_t(c.id[i])) << 32 | mCode;
+            auto found = dictionary.find(key);
+            if (found == dictionary.end()) {
+                full = dictionaryId.size() == 65536; //entries are uint16
+                if (full) break;
+                found = dictionary.emplace(key, uint16_t(dictionaryId.size())).first;
+                dictionaryId.push_back(c.id[i]);
+                dictionaryM.push_back(mCode * q.mStep);
+            }
+            entry[i] = found->second;
+        }
+        if (full) { //the block ends before this event, without its entries
+            dictionaryId.resize(nEntries), dictionaryM.resize(nEntries);
+            nEv = k, nP = c.offsets[k];
+            break;
+        }
+    }
+    if (nEv == 0) return 0;
+
+    //particles of every event in the order of phi, delta coded
+    std::vector<uint32_t> order(nP), phiOffsets(nEv + 1, 0);
+    std::vector<uint8_t> stream;
+    for (uint32_t k = 0; k < nEv; ++k) {
+        auto first = order.begin() + c.offsets[k], last = order.begin() + c.offsets[k + 1];
+        std::iota(first, last, c.offsets[k]);
+        std::sort(first, last, [&phi](uint32_t a, uint32_t b) { return phi[a] < phi[b]; });
+        uint32_t previous = 0;
+        for (auto it = first; it != last; ++it) {
+            uint32_t delta = phi[*it] - previous;
+            previous = phi[*it];
+            for (; delta >= 0x80; delta >>= 7) stream.push_back(uint8_t(delta) | 0x80);
+            stream.push_back(uint8_t(delta));
+        }
+        phiOffsets[k + 1] = stream.size();
+    }
+
+    PackedCounts counts{uint32_t(dictionaryId.size()), uint32_t(stream.size())};
+    PackedLayout layout(nEv, nP, counts);
+    out.assign(layout.size, 0);
+    char *block = out.data();
+    BlockHeader header{nEv, nP, layout.size};
+    memcpy(block, &header, sizeof(header));
+    memcpy(block + sizeof(header), &counts, sizeof(counts));
+    memcpy(block + layout.number, c.number, 4 * nEv);
+    memcpy(block + layout.weight, c.weight, 8 * nEv);
+    memcpy(block + layout.sigma, c.sigma, 8 * nEv);
+    memcpy(block + layout.pTHat, c.pTHat, 8 * nEv);
+    memcpy(block + layout.offsets, c.offsets, 4 * (nEv + 1));
+    memcpy(block + layout.phiOffsets, phiOffsets.data(), 4 * (nEv + 1));
+    memcpy(block + layout.dictionaryId, dictionaryId.data(), 4 * counts.nDictionary);
+    memcpy(block + layout.dictionaryM, dictionaryM.data(), 4 * counts.nDictionary);
+    auto outPT = (uint16_t *) (block + layout.pT), outEntry = (uint16_t *) (block + layout.entry);
+    auto outY = (int16_t *) (block + layout.y), outStatus = (int16_t *) (block + layout.status);
+    auto outCharge = (int8_t *) (block + layout.charge);
+    for (uint32_t j = 0; j < nP; ++j) {
+        uint32_t i = order[j];
+        outPT[j] = pT[i], outY[j] = y[i], outEntry[j] = entry[i];
+        outCharge[j] = c.charge[i], outStatus[j] = c.status[i];
+    }
+    memcpy(block + layout.phi, stream.data(), stream.size());
+    return nEv;
+}
+
+//==========================================================================
+// Decoding. Only the phi varints are sequential, the rest are independent table lookups per
+// particle, which the compiler can vectorize (gathers with AVX2).
+
+PackedDecoder::PackedDecoder(const Quantization &q) {
+    double lnStep = std::log1p(q.pTprecision);
+    pT.resize(65536);
+    for (int i = 0; i < 65536; ++i) pT[i] = q.pTmin * std::exp(i * lnStep);
+    //pairs used together sit next to each other, one cache line per lookup
+    y.resize(2 * 65535); //sinh, cosh, indexed by code + 32767
+    for (int i = 0; i < 65535; ++i) {
+        y[2 * i] = std::sinh((i - 32767) * q.yStep);
+        y[2 * i + 1] = std::cosh((i - 32767) * q.yStep);
+    }
+    int nPhi = nPhiCodes(q);
+    double phiStep = 2 * M_PI / nPhi;
+    phi.resize(2 * nPhi); //cos, sin
+    for (int i = 0; i < nPhi; ++i) {
+        phi[2 * i] = std::cos(i * phiStep - M_PI);
+        phi[2 * i + 1] = std::sin(i * phiStep - M_PI);
+    }
+}
+
+PackedLayout PackedDecoder::layout(const char *block) const {
+    auto header = (const BlockHeader *) block;
+    PackedCounts counts;
+    memcpy(&counts, block + sizeof(BlockHeader), sizeof(counts));
+    return PackedLayout(header->nEvents, header->nParticles, counts);
+}
+
+void PackedDecoder::unpack(const char *block, uint32_t k, UnpackedEvent &out) const {
+    PackedLayout l = layout(block);
+    auto offsets = (const uint32_t *) (block + l.offsets), phiOffsets = (const uint32_t *) (block + l.phiOffsets);
+    uint32_t first = offsets[k], n = offsets[k + 1] - first;
+    out.px.resize(n), out.py.resize(n), out.pz.resize(n), out.e.resize(n), out.phi.resize(n);
+    out.id.resize(n), out.charge.resize(n), out.status.resize(n);
+
+    //branchless varints: phi codes need at most 3 bytes, so 4 loaded bytes always hold the last one
+    auto stream = (const uint8_t *) (block + l.phi) + phiOffsets[k];
+    uint32_t code = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t word;
+        memcpy(&word, stream, 4); //little endian
+        int length = (__builtin_ctz(~word & 0x80808080u) >> 3) + 1;
+        uint32_t delta = (word & 0x7f) | (word >> 1 & 0x3f80) | (word >> 2 & 0x1fc000) | (word >> 3 & 0xfe00000);
+        delta &= (1u << 7 * length) - 1;
+        stream += length;
+        out.phi[i] = code += delta;
+    }
+
+    auto pTcode = (const uint16_t *) (block + l.pT) + first, entry = (const uint16_t *) (block + l.entry) + first;
+    auto yCode = (const int16_t *) (block + l.y) + first;
+    auto dictionaryId = (const int32_t *) (block + l.dictionaryId);
+    auto dictionaryM = (const float *) (block + l.dictionaryM);
+    const float *pTtable = pT.data(), *yTable = y.data() + 2 * 32767, *phiTable = phi.data();
+    const uint32_t *phiCode = out.phi.data();
+    float *px = out.px.data(), *py = out.py.data(), *pz = out.pz.data(), *e = out.e.data();
+    int32_t *id = out.id.data();
+    for (uint32_t i = 0; i < n; ++i) {
+        float pt = pTtable[pTcode[i]], m = dictionaryM[entry[i]];
+        float mT = std::sqrt(pt * pt + m * m);
+        px[i] = pt * phiTable[2 * phiCode[i]];
+        py[i] = pt * phiTable[2 * phiCode[i] + 1];
+        pz[i] = mT * yTable[2 * yCode[i]];
+        e[i] = mT * yTable[2 * yCode[i] + 1];
+        id[i] = dictionaryId[entry[i]];
+    }
+    memcpy(out.charge.data(), block + l.charge + first, n);
+    memcpy(out.status.data(), block + l.status + 2 * first, 2 * n);
+}
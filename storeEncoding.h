@@ -0,0 +1,89 @@
+//
+// Quantized encoding of the particle columns of an event store block (Store:encoding = 1).
+// Particles are kept as (pT, y, phi, m) on fixed grids: pT and y as 16 bit codes, phi sorted
+// within the event and delta coded as varints, id and mass through a dictionary of the block.
+// Decoding goes through tables built once per store, so it is lookups and multiplications only.
+//
+
+#ifndef PYTHIAPROJECT_STOREENCODING_H
+#define PYTHIAPROJECT_STOREENCODING_H
+
+#include <cstdint>
+#include <vector>
+
+
+
+// Follows the StoreHeader of a quantized store, the first block comes after it.
+struct Quantization {
+    float pTmin = 1e-4;        //GeV, lower pT are stored as pTmin
+    float pTprecision = 1e-3;  //relative
+    float yStep = 1e-3;        //|y| up to 32767 yStep
+    float phiStep = 1e-4;      //rad, at least 1e-5
+    float mStep = 1e-4;        //GeV
+    uint32_t reserved[3] = {};
+};
+
+// pT codes go up to 65535, pTmin (1 + pTprecision)^65535, and y codes up to 32767 yStep; values beyond
+// are clamped to the last code. The finest steps which still reach kMaxStoredPt and kMaxStoredY:
+const float kMaxStoredPt = 1e5; //GeV
+const float kMaxStoredY = 20;
+const float kMinYStep = kMaxStoredY / 32767;
+float minPTprecision(float pTmin);
+
+// A quantized block is a BlockHeader followed by PackedCounts and then the columns, each starting
+// at a multiple of 8 bytes:
+//   per event:      number int32, weight, sigma, pTHat float64, offsets uint32[nEvents + 1],
+//                   phiBytes uint32[nEvents + 1] (start of the event in the phi stream)
+//   dictionary:     id int32, m float32 [nDictionary]
+//   per particle:   pT uint16, y int16, entry uint16 (in the dictionary), charge int8, status int16
+//   phi stream:     varint deltas of the sorted phi codes, each event starts from 0
+struct PackedCounts {
+    uint32_t nDictionary, phiBytes;
+};
+
+struct PackedLayout {
+    PackedLayout(uint32_t nEvents, uint32_t nParticles, const PackedCounts &counts);
+
+    uint64_t number, weight, sigma, pTHat, offsets, phiOffsets, dictionaryId, dictionaryM;
+    uint64_t pT, y, entry, charge, status, phi, size; //from block start
+};
+
+// Columns of one block as EventStoreWriter collects them.
+struct BlockColumns {
+    const int32_t *number;
+    const double *weight, *sigma, *pTHat;
+    const uint32_t *offsets;
+    const double *px, *py, *pz, *e;
+    const int32_t *id;
+    const int8_t *charge;
+    const int16_t *status;
+    uint32_t nEvents, nParticles;
+};
+
+// Encodes the block into out, BlockHeader included. The dictionary has room for 65536 (id, m) pairs,
+// the events from the first one which would overflow it on are left out; returns the number encoded,
+// 0 if the first event alone has more pairs.
+uint32_t packBlock(const BlockColumns &columns, const Quantization &quantization, std::vector<char> &out);
+
+// Decoded particles of one event, single precision.
+struct UnpackedEvent {
+    std::vector<float> px, py, pz, e;
+    std::vector<int32_t> id;
+    std::vector<int8_t> charge;
+    std::vector<int16_t> status;
+    std::vector<uint32_t> phi; //codes, scratch
+};
+
+class PackedDecoder {
+public:
+    explicit PackedDecoder(const Quantization &quantization);
+
+    // Event k of the block; number, weight, sigma and pTHat are read directly from the block.
+    void unpack(const char *block, uint32_t k, UnpackedEvent &out) const;
+    PackedLayout layout(const char *block) const;
+
+private:
+    std::vector<float> pT, y, phi; //by code: pT, (sinh y, cosh y), (cos phi, sin phi)
+};
+
+#endif //PYTHIAPROJECT_STOREENCODING_H
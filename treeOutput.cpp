@@ -0,0 +1,120 @@
+#include "treeOutput.h"
+
+#include <cmath>
+
+#include "TROOT.h"
+#include "TTree.h"
+
+
+
+TString jetBranchName(const fastjet::JetDefinition &jetDef) {
+    TString algorithm = jetDef.jet_algorithm() == fastjet::antikt_algorithm ? "antikt"
+                      : jetDef.jet_algorithm() == fastjet::kt_algorithm ? "kt"
+                      : jetDef.jet_algorithm() == fastjet::cambridge_algorithm ? "ca" : "jets";
+    return algorithm + Form("_R%02d", int(std::lround(jetDef.R() * 10)));
+}
+
+TreeOutput::TreeOutput(const std::string &file, const std::map<TString, fastjet::JetDefinition> &jetDefs,
+                       double pTmin, int nWorkers, int compression, int basketSize, long autoFlush,
+                       StageTimers *timers)
+        : merger(file.c_str(), "RECREATE", compression), pTmin(pTmin), basketSize(basketSize),
+          autoFlush(autoFlush), queue(4 * nWorkers), timers(timers) {
+    ROOT::EnableThreadSafety(); //before the workers touch ROOT
+    for (auto &jetDef: jetDefs) {
+        this->jetDefs.push_back(jetDef.second);
+        names.push_back(jetBranchName(jetDef.second));
+        if (timers) stageClustering.push_back(timers->stage("tree clustering " + std::string(names.back().Data())));
+    }
+    if (timers) stageFill = timers->stage("tree fill");
+    fastjet::ClusterSequence::print_banner(); //not from the workers
+    for (int i = 0; i < nWorkers; ++i) workers.emplace_back(&TreeOutput::work, this);
+}
+
+void TreeOutput::push(const FinalState &finalState) {
+    queue.push(finalState);
+}
+
+void TreeOutput::close() {
+    queue.close();
+    for (auto &worker: workers) worker.join();
+    workers.clear();
+}
+
+//==========================================================================
+// One worker: its own tree, branch buffers and clustering input.
+
+struct JetBranches {
+    std::vector<float> pt, y, phi, m;
+    std::vector<int> n, constituents;
+
+    void clear() {
+        pt.clear(), y.clear(), phi.clear(), m.clear(), n.clear(), constituents.clear();
+    }
+};
+
+void TreeOutput::work() {
+    auto file = merger.GetFile();
+    TTree tree("events", "Events with jets", 99, file.get());
+    tree.SetAutoFlush(autoFlush);
+
+    FinalState event;
+    std::vector<float> px, py, pz, e;
+    std::vector<int> id;
+    std::vector<JetBranches> jets(jetDefs.size());
+    tree.Branch("event", &event.number);
+    tree.Branch("weight", &event.weight);
+    tree.Branch("sigma", &event.sigma);
+    tree.Branch("pTHat", &event.pTHat);
+    tree.Branch("px", &px);
+    tree.Branch("py", &py);
+    tree.Branch("pz", &pz);
+    tree.Branch("e", &e);
+    tree.Branch("id", &id);
+    for (size_t d = 0; d < jetDefs.size(); ++d) {
+        tree.Branch(names[d] + "_pt", &jets[d].pt);
+        tree.Branch(names[d] + "_y", &jets[d].y);
+        tree.Branch(names[d] + "_phi", &jets[d].phi);
+        tree.Branch(names[d] + "_m", &jets[d].m);
+        tree.Branch(names[d] + "_n", &jets[d].n);
+        tree.Branch(names[d] + "_constituents", &jets[d].constituents);
+    }
+    tree.SetBasketSize("*", basketSize);
+
+    std::vector<fastjet::PseudoJet> input;
+    long nFilled = 0;
+    StageTimers disabled(false);
+    auto &timers = this->timers ? *this->timers : disabled;
+    if (timers.tracing()) timers.nameThread("tree output");
+    while (queue.pop(event)) {
+        if (timers.tracing()) timers.setEvent(event.number);
+        px.assign(event.px.begin(), event.px.end());
+        py.assign(event.py.begin(), event.py.end());
+        pz.assign(event.pz.begin(), event.pz.end());
+        e.assign(event.e.begin(), event.e.end());
+        id.assign(event.id.begin(), event.id.end());
+
+        input.clear();
+        appendPseudoJets(event.view(), input);
+        for (size_t i = 0; i < input.size(); ++i) input[i].set_user_index(i);
+
+        for (size_t d = 0; d < jetDefs.size(); ++d) {
+            ScopedTimer timer(timers, stageClustering.empty() ? 0 : stageClustering[d]);
+            fastjet::ClusterSequence clustSeq(input, jetDefs[d]);
+            auto &branches = jets[d];
+            branches.clear();
+            for (auto &jet: sorted_by_pt(clustSeq.inclusive_jets(pTmin))) {
+                auto constituents = jet.constituents();
+                branches.pt.push_back(jet.pt());
+                branches.y.push_back(jet.rap());
+                branches.phi.push_back(jet.phi_std());
+                branches.m.push_back(jet.m());
+                branches.n.push_back(constituents.size());
+                for (auto &c: constituents) branches.constituents.push_back(c.user_index());
+            }
+        }
+        ScopedTimer fillTimer(timers, stageFill);
+        tree.Fill();
+        if (++nFilled % autoFlush == 0) file->Write(); //hands the buffer to the merger, memory stays bounded
+    }
+    file->Write();
+}
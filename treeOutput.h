@@ -0,0 +1,59 @@
+//
+// ROOT file with one TTree entry per event: event info, final-state particles and the jets of every
+// jet definition with their constituents. Events are clustered and written by worker threads.
+//
+
+#ifndef PYTHIAPROJECT_TREEOUTPUT_H
+#define PYTHIAPROJECT_TREEOUTPUT_H
+
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TString.h"
+#include "ROOT/TBufferMerger.hxx"
+#include "fastjet/ClusterSequence.hh"
+
+#include "boundedQueue.h"
+#include "eventReplay.h"
+#include "stageTimers.h"
+
+
+
+// Branches of tree "events", <def> is e.g. antikt_R03 (see jetBranchName):
+//   event, weight, sigma, pTHat
+//   px, py, pz, e, id                      final-state particles
+//   <def>_pt, _y, _phi, _m, _n             jets above pTmin, _n is the number of constituents
+//   <def>_constituents                     indices into the particle branches, _n of them per jet
+// Every worker fills its own tree in a TBufferMergerFile, ROOT::TBufferMerger merges them into one file.
+class TreeOutput {
+public:
+    TreeOutput(const std::string &file, const std::map<TString, fastjet::JetDefinition> &jetDefs, double pTmin,
+               int nWorkers, int compression, int basketSize, long autoFlush,
+               StageTimers *timers = nullptr); //the workers time their clustering and filling
+    ~TreeOutput() { close(); }
+
+    void push(const FinalState &finalState); //waits while all workers are busy and the queue is full
+    void close(); //after the last event
+    size_t queued() { return queue.size(); } //events waiting for a worker
+
+private:
+    void work();
+
+    ROOT::TBufferMerger merger;
+    std::vector<fastjet::JetDefinition> jetDefs;
+    std::vector<TString> names;
+    double pTmin;
+    int basketSize;
+    long autoFlush;
+    BoundedQueue<FinalState> queue;
+    StageTimers *timers;
+    std::vector<int> stageClustering;
+    int stageFill = 0;
+    std::vector<std::thread> workers;
+};
+
+TString jetBranchName(const fastjet::JetDefinition &jetDef);
+
+#endif //PYTHIAPROJECT_TREEOUTPUT_H
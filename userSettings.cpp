@@ -0,0 +1,101 @@
+#include "userSettings.h"
+
+
+
+void addUserSettings(Pythia8::Settings &settings) {
+    //binning of the jet images, see Binning
+    settings.addMode("Display:nRapidityBins", 400 / 2, true, false, 1, 0);
+    settings.addMode("Display:nPhiBins", 314 / 2, true, false, 1, 0);
+    settings.addParm("Display:rapidityMax", 4., true, false, 0.1, 0.);
+
+    //animated frames: 0 - off, 1 - one frame per event, 2 - clustering history of the leading jet
+    settings.addMode("Frames:mode", 0, true, true, 0, 2);
+    settings.addWord("Frames:pattern", "../results/frames/frame_%05d.png");
+    settings.addParm("Frames:pTmax", 200., true, false, 1., 0.); //upper end of the palette
+    settings.addMode("Frames:event", 0, true, false, 0, 0); //event whose leading jet history is shown
+    settings.addMode("Frames:nSteps", 100, true, false, 1, 0); //maximal number of history frames
+
+    //stored run for eventBrowser, empty - nothing is stored
+    settings.addWord("Store:file", "");
+    settings.addParm("Store:jetR", 0.3, true, false, 0.01, 0.); //anti-kt jets of the summary index
+    settings.addParm("Store:pTminJet", 5., true, false, 0., 0.);
+    settings.addMode("Store:precision", 4, true, true, 4, 8); //bytes per momentum component, 4 or 8
+    settings.addMode("Store:eventsPerBlock", 1000, true, true, 1, 65535);
+    settings.addMode("Store:encoding", 0, true, true, 0, 1); //0 - float columns, 1 - quantized (pT, y, phi, m)
+    //finer ones would clamp pT above 1e5 GeV and |y| above 20, see Quantization
+    settings.addParm("Store:pTprecision", 1e-3, true, false, 3.2e-4, 0.); //relative
+    settings.addParm("Store:yPrecision", 1e-3, true, false, 6.2e-4, 0.);
+    settings.addParm("Store:phiPrecision", 1e-4, true, false, 1e-5, 0.); //rad
+    settings.addParm("Store:mPrecision", 1e-4, true, false, 1e-7, 0.); //GeV
+
+    //replay of a stored run instead of generating, empty - generate
+    settings.addWord("Replay:file", "");
+    settings.addMode("Replay:nThreads", 4, true, false, 1, 0); //per-event clustering of the replayed events
+
+    //HepMC3 ASCII input instead of generating and output of the generated events, empty - none
+    settings.addWord("HepMC:input", "");
+    settings.addWord("HepMC:output", "");
+    settings.addMode("HepMC:queueSize", 64, true, false, 1, 0); //events parsed ahead of the clustering
+
+    //ROOT file with a TTree of particles and jets per event, empty - none
+    settings.addWord("Tree:file", "");
+    settings.addMode("Tree:nWorkers", 4, true, false, 1, 0);
+    settings.addMode("Tree:compression", 404, true, false, 0, 0); //ROOT compression setting, 404 - LZ4 level 4
+    settings.addMode("Tree:basketSize", 256000, true, false, 1000, 0); //bytes
+    settings.addMode("Tree:autoFlush", 1000, true, false, 1, 0); //events of a worker per merge
+
+    //jet catalog for jetQuery, empty - none
+    settings.addWord("Catalog:file", "");
+    settings.addFlag("Catalog:area", false); //cluster with ghosts to get jet areas, much slower
+    //memory for sorting the catalog indexes, above it sorted runs are spilled to files and merged at the end
+    settings.addMode("Catalog:sortMemory", 1024, true, false, 1, 0); //MB
+    settings.addWord("Catalog:spillDirectory", "/tmp");
+
+    //shared memory ring streaming events and jets to other processes (ringMonitor), empty - none
+    settings.addWord("Ring:name", "");
+    settings.addMode("Ring:nSlots", 256, true, false, 2, 0);
+    settings.addMode("Ring:slotSize", 131072, true, false, 1024, 0); //bytes, larger events are not published
+    settings.addMode("Ring:policy", 0, true, true, 0, 1); //0 - wait for the slowest consumer, 1 - drop oldest
+
+    //writing of the event store and the jet catalog
+    settings.addFlag("Output:async", true); //io_uring where the kernel allows it, else pwrite()
+    settings.addMode("Output:chunkSize", 4194304, true, false, 4096, 0); //bytes per write
+    settings.addMode("Output:maxInFlight", 4, true, false, 1, 0); //chunks written at the same time
+    settings.addFlag("Output:fsync", false); //wait until the files are on disk before closing them
+
+    //events for the browser viewer eventDisplay.html, empty - none; jets are clustered with ghosts for the
+    //jet areas, as with Catalog:area
+    settings.addWord("Export:file", "");
+
+    //several processes started by mpirun, main built with mpicxx -DPYTHIAPROJECT_MPI; outputs get .rank<N>
+    settings.addMode("Mpi:seed", 1, true, true, 1, 899999000); //rank r generates with Random:seed = seed + r
+    settings.addMode("Mpi:reduceEvery", 0, true, false, 0, 0); //events between intermediate sums, 0 - at the end only
+
+    //jet spectra in shared memory, every process on the node which uses the name adds to them and
+    //spectraMonitor reads the sums; empty - none
+    settings.addWord("Shared:name", "");
+
+    //worker of workCoordinator listening on this UNIX socket, empty - none; the events and seeds come in
+    //units from the coordinator instead of Main:numberOfEvents, outputs get .worker<pid>
+    settings.addWord("Work:socket", "");
+
+    //Prometheus text-format metrics for the textfile collector of node_exporter, empty - none; the name
+    //should end in .prom, processes of mpirun or workCoordinator insert .rank<N> or .worker<pid> before it
+    settings.addWord("Metrics:file", "");
+    settings.addParm("Metrics:interval", 15, true, false, 0.1, 0); //seconds between rewrites
+
+    //one JSON line per event with its weight, pTHat, multiplicity and the jets of every definition, empty - none
+    settings.addWord("Summary:file", "");
+
+    //table of the wall-clock time per stage (generation, selection, clustering per jet definition, outputs,
+    //drawing, printing) with mean, p50, p99 and max, printed at the end by the process drawing the pages
+    settings.addFlag("Timing:report", false);
+
+    //timeline of every stage per event and thread in the Chrome trace-event format, for Perfetto; empty - none
+    settings.addWord("Timing:trace", "");
+    settings.addMode("Timing:traceRecords", 2000000, true, false, 1, 0); //per thread, 32 bytes each, then dropped
+
+    //hardware counters (cycles, instructions, cache and branch misses) around the same stages through
+    //perf_event_open, reported per event and per particle with the IPC; only timed where unavailable
+    settings.addFlag("Timing:counters", false);
+}
@@ -0,0 +1,13 @@
+//
+// Settings of this project which are not part of Pythia itself.
+// They are registered before the .cmnd file is read, so they can be set there like any other.
+//
+
+#ifndef PYTHIAPROJECT_USERSETTINGS_H
+#define PYTHIAPROJECT_USERSETTINGS_H
+
+#include "Pythia8/Pythia.h"
+
+void addUserSettings(Pythia8::Settings &settings);
+
+#endif //PYTHIAPROJECT_USERSETTINGS_H
@@ -0,0 +1,219 @@
+//
+// Splits a run into work units of --unit events, each with a seed of its own (--seed + unit), and
+// hands them out over a UNIX socket to the main processes started with Work:socket, the next unit
+// to whichever worker is free. A worker which dies or runs longer than --timeout seconds on a unit
+// loses all its units to the others, since its outputs are incomplete. When every unit is done by a
+// worker which closed its outputs, --merge runs through the shell with WORK_WORKERS set to the pids
+// of those workers (their outputs carry the suffix .worker<pid>), e.g.
+//   --merge 'hadd -f jets.root $(for p in $WORK_WORKERS; do echo jets.root.worker$p; done)'
+// Workers are told to finish once no unit is pending or running; should one of them die before it
+// closed its outputs, its units wait for a worker started anew. Shared spectra (Shared:name) also
+// hold the events of units cut short, rather merge the outputs of the workers.
+//
+//   workCoordinator <socket> --events n [--unit n] [--seed s] [--timeout s] [--merge command]
+//
+// Built from workCoordinator.cpp and workQueue.cpp, without ROOT.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "workQueue.h"
+
+
+
+using Clock = std::chrono::steady_clock;
+
+enum UnitState { kPending, kRunning, kCompleted, kFinal }; //kCompleted - by a worker which has not exited yet
+
+struct Worker {
+    int fd = -1;
+    int32_t pid = 0;
+    std::vector<uint32_t> running, completed;
+    Clock::time_point since; //of the running unit
+    bool waiting = false;    //for a unit, none is pending
+};
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <socket> --events n [--unit n] [--seed s] [--timeout s] [--merge command]\n", argv[0]);
+        return 1;
+    }
+    long nEvents = 0, unitSize = 1000, seed = 1;
+    double timeout = 0;
+    std::string merge;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--events")) nEvents = atol(argv[i + 1]);
+        else if (!strcmp(argv[i], "--unit")) unitSize = atol(argv[i + 1]);
+        else if (!strcmp(argv[i], "--seed")) seed = atol(argv[i + 1]);
+        else if (!strcmp(argv[i], "--timeout")) timeout = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "--merge")) merge = argv[i + 1];
+    }
+    if (nEvents <= 0 || unitSize <= 0) {
+        printf("--events and --unit have to be positive\n");
+        return 1;
+    }
+
+    std::vector<WorkUnit> units((nEvents + unitSize - 1) / unitSize);
+    std::vector<UnitState> states(units.size(), kPending);
+    std::deque<uint32_t> pending;
+    for (uint32_t u = 0; u < units.size(); ++u) {
+        units[u].id = u;
+        units[u].first = int64_t(u) * unitSize;
+        units[u].nEvents = std::min<long>(unitSize, nEvents - units[u].first);
+        units[u].seed = seed + u;
+        pending.push_back(u);
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (strlen(argv[1]) >= sizeof(address.sun_path)) {
+        printf("Socket path %s is too long\n", argv[1]);
+        return 1;
+    }
+    strcpy(address.sun_path, argv[1]);
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(argv[1]); //left by an earlier run
+    if (listener < 0 || bind(listener, (sockaddr *) &address, sizeof(address)) != 0 || listen(listener, 64) != 0) {
+        printf("Cannot listen on %s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+    printf("%zu work units of %ld events on %s\n", units.size(), unitSize, argv[1]);
+
+    //==========================================================================
+    // One thread, poll() over the listener and the workers.
+
+    std::vector<Worker> workers;
+    std::vector<int32_t> finishedPids;
+    size_t nFinal = 0, nCompleted = 0;
+    long nRequeued = 0, nLost = 0;
+    auto start = Clock::now(), lastReport = start;
+
+    auto assign = [&](Worker &worker) {
+        WorkMessage message{};
+        if (pending.empty() && nFinal + nCompleted < units.size()) {
+            worker.waiting = true;
+            return true;
+        }
+        worker.waiting = false;
+        message.type = pending.empty() ? kFinished : kAssign;
+        if (!pending.empty()) {
+            uint32_t u = pending.front();
+            pending.pop_front();
+            states[u] = kRunning;
+            worker.running.push_back(u);
+            worker.since = Clock::now();
+            message.unit = units[u];
+        }
+        return sendWorkMessage(worker.fd, message);
+    };
+    //the units of a worker gone without kExit go back to the front of the queue
+    auto lose = [&](Worker &worker, const char *why) {
+        std::vector<uint32_t> lost = worker.running;
+        lost.insert(lost.end(), worker.completed.begin(), worker.completed.end());
+        if (!lost.empty()) {
+            printf("Worker %d %s, %zu units handed out again\n", worker.pid, why, lost.size());
+            ++nLost;
+        }
+        for (uint32_t u: lost) {
+            if (states[u] == kCompleted) --nCompleted;
+            states[u] = kPending;
+            pending.push_front(u);
+            ++nRequeued;
+        }
+        close(worker.fd);
+        worker.fd = -1;
+    };
+
+    while (nFinal < units.size()) {
+        std::vector<pollfd> fds(1 + workers.size());
+        fds[0] = {listener, POLLIN, 0};
+        for (size_t w = 0; w < workers.size(); ++w) fds[1 + w] = {workers[w].fd, POLLIN, 0};
+        if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+            printf("poll: %s\n", strerror(errno));
+            break;
+        }
+
+        for (size_t w = 0; w < workers.size(); ++w) {
+            auto &worker = workers[w];
+            if (!(fds[1 + w].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            WorkMessage message;
+            if (!receiveWorkMessage(worker.fd, message)) {
+                lose(worker, "died");
+                continue;
+            }
+            worker.pid = message.pid;
+            auto running = std::find(worker.running.begin(), worker.running.end(), message.unit.id);
+            if (message.type == kRequest) {
+                if (!assign(worker)) lose(worker, "is gone");
+            } else if (message.type == kComplete && running != worker.running.end()) {
+                worker.running.erase(running);
+                worker.completed.push_back(message.unit.id);
+                states[message.unit.id] = kCompleted;
+                ++nCompleted;
+            } else if (message.type == kExit) {
+                for (uint32_t u: worker.completed) states[u] = kFinal;
+                nFinal += worker.completed.size();
+                nCompleted -= worker.completed.size();
+                if (!worker.completed.empty()) finishedPids.push_back(worker.pid);
+                worker.completed.clear();
+                lose(worker, "exited"); //nothing is left to lose
+            }
+        }
+        if (timeout > 0)
+            for (auto &worker: workers)
+                if (worker.fd >= 0 && !worker.running.empty() &&
+                    std::chrono::duration<double>(Clock::now() - worker.since).count() > timeout)
+                    lose(worker, "timed out");
+        workers.erase(std::remove_if(workers.begin(), workers.end(), [](const Worker &worker) {
+            return worker.fd < 0;
+        }), workers.end());
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0) workers.emplace_back(), workers.back().fd = fd;
+        }
+
+        //waiting workers get the units handed out again, or kFinished at the end
+        for (auto &worker: workers)
+            if (worker.waiting && (!pending.empty() || nFinal + nCompleted == units.size()) && !assign(worker))
+                lose(worker, "is gone");
+
+        if (std::chrono::duration<double>(Clock::now() - lastReport).count() >= 10) {
+            lastReport = Clock::now();
+            printf("%zu of %zu units done (%zu of them by workers still running), %zu workers\n",
+                   nFinal + nCompleted, units.size(), nCompleted, workers.size());
+        }
+    }
+    for (auto &worker: workers) close(worker.fd);
+    close(listener);
+    unlink(argv[1]);
+    if (nFinal < units.size()) return 1;
+
+    printf("%zu work units of %ld events done by %zu workers in %.1f s, %ld units handed out again after %ld "
+           "workers failed\n", units.size(), nEvents, finishedPids.size(),
+           std::chrono::duration<double>(Clock::now() - start).count(), nRequeued, nLost);
+    if (merge.empty()) return 0;
+
+    std::string pids;
+    for (auto pid: finishedPids) pids += (pids.empty() ? "" : " ") + std::to_string(pid);
+    setenv("WORK_WORKERS", pids.c_str(), 1);
+    printf("Merging: %s\n", merge.c_str());
+    fflush(stdout);
+    int status = system(merge.c_str());
+    if (status != 0) printf("The merge failed with status %d\n", WIFEXITED(status) ? WEXITSTATUS(status) : status);
+    return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+#include "workQueue.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+
+static_assert(sizeof(WorkMessage) == 40, "work messages are read and written as they are");
+
+bool sendWorkMessage(int fd, const WorkMessage &message) {
+    auto data = reinterpret_cast<const char *>(&message);
+    for (size_t done = 0; done < sizeof(message);) {
+        ssize_t n = send(fd, data + done, sizeof(message) - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+bool receiveWorkMessage(int fd, WorkMessage &message) {
+    auto data = reinterpret_cast<char *>(&message);
+    for (size_t done = 0; done < sizeof(message);) {
+        ssize_t n = recv(fd, data + done, sizeof(message) - done, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+//==========================================================================
+// Worker side. Workers may be started before the coordinator, so connecting is retried.
+
+WorkClient::WorkClient(const std::string &socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        printf("Work socket path %s is too long\n", socketPath.c_str());
+        return;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+    for (int nTries = 0; nTries < 50; ++nTries) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) break;
+        if (connect(fd, (sockaddr *) &address, sizeof(address)) == 0) return;
+        close(fd);
+        fd = -1;
+        usleep(100000);
+    }
+    printf("Cannot connect to the work coordinator at %s: %s\n", socketPath.c_str(), strerror(errno));
+}
+
+WorkClient::~WorkClient() {
+    if (fd >= 0) close(fd); //without finish() the coordinator hands the units out again
+}
+
+bool WorkClient::next() {
+    if (fd < 0) return false;
+    WorkMessage message{};
+    message.pid = getpid();
+    if (assigned) {
+        message.type = kComplete;
+        message.unit = current;
+        if (!sendWorkMessage(fd, message)) return false;
+        assigned = false;
+        ++nDone;
+    }
+    message.type = kRequest;
+    if (!sendWorkMessage(fd, message) || !receiveWorkMessage(fd, message) || message.type != kAssign) {
+        finished = message.type == kFinished;
+        if (!finished) close(fd), fd = -1; //the coordinator is gone
+        return false;
+    }
+    current = message.unit;
+    assigned = true;
+    return true;
+}
+
+void WorkClient::finish() {
+    if (fd < 0 || !finished) return;
+    WorkMessage message{};
+    message.type = kExit;
+    message.pid = getpid();
+    sendWorkMessage(fd, message);
+    close(fd);
+    fd = -1;
+}
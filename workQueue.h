@@ -0,0 +1,63 @@
+//
+// Work units (event ranges with their own seed) handed out by workCoordinator over a local UNIX
+// socket, so any number of main processes share a run and take the next unit when they are free.
+// Fixed-size binary messages over a stream socket; standard library and POSIX only.
+//
+
+#ifndef PYTHIAPROJECT_WORKQUEUE_H
+#define PYTHIAPROJECT_WORKQUEUE_H
+
+#include <cstdint>
+#include <string>
+
+
+
+// worker -> coordinator: kRequest (the next unit), kComplete (unit done), kExit (outputs closed)
+// coordinator -> worker: kAssign (a unit), kFinished (no work left)
+// A worker asks for one unit at a time and says it is complete before it asks again. Its units only
+// count once it has closed its outputs and sent kExit; a worker which dies or hangs before, loses
+// all of them to the others. The coordinator answers a request only when it has a unit or when
+// the run is over, so a worker may wait for the units of a worker which died.
+enum WorkMessageType : uint32_t { kRequest = 1, kComplete = 2, kAssign = 3, kFinished = 4, kExit = 5 };
+
+struct WorkUnit {
+    uint32_t id = 0;
+    uint32_t pad = 0;
+    int64_t first = 0, nEvents = 0; //event numbers first .. first + nEvents - 1
+    uint64_t seed = 0;
+};
+
+struct WorkMessage {
+    uint32_t type;
+    int32_t pid; //of the worker, its outputs are named after it
+    WorkUnit unit;
+};
+
+// Blocking send and receive of a whole message, false when the peer is gone.
+bool sendWorkMessage(int fd, const WorkMessage &message);
+bool receiveWorkMessage(int fd, WorkMessage &message);
+
+// Worker side, used by main.cpp when Work:socket is set.
+class WorkClient {
+public:
+    explicit WorkClient(const std::string &socketPath); //connects, retrying for a few seconds
+    ~WorkClient();
+    WorkClient(const WorkClient &) = delete;
+    WorkClient &operator=(const WorkClient &) = delete;
+
+    bool good() const { return fd >= 0; }
+    //the current unit complete (if any), then the next one; false when there is no work left
+    bool next();
+    void finish(); //after the outputs are closed, the units done count from now on
+    const WorkUnit &unit() const { return current; }
+    int64_t end() const { return current.first + current.nEvents; } //one past the last event of the unit
+    long nUnits() const { return nDone; }
+
+private:
+    int fd = -1;
+    bool assigned = false, finished = false;
+    WorkUnit current;
+    long nDone = 0;
+};
+
+#endif //PYTHIAPROJECT_WORKQUEUE_H